@@ -13,33 +13,53 @@
 #pragma once
 
 #include "PluginProcessor.h"
-#include "PluginEditor.h"
 #include "util/Constants.h"
-#include <juce_audio_plugin_client/Standalone/juce_StandaloneFilterWindow.h>
+#include "util/RealtimeSafety.h"
+
+// GLOBE_LOVELER_HEADLESS builds the processor without editor or standalone wrapper, e.g. for the offline renderer
+#if ! GLOBE_LOVELER_HEADLESS
+    #include "PluginEditor.h"
+    #include <juce_audio_plugin_client/Standalone/juce_StandaloneFilterWindow.h>
+#endif
+
+const char* const GlobeLoveler::parameterIDs[numParameters] = {
+    "inputgain", "threshold", "ratio", "knee", "attack", "release", "makeup", "mix", "detection", "lookahead",
+    "limiter", "ceiling", "limiterrelease", "oversampling", "oversamplingphase",
+    "sidechain", "sidechainhighpass", "sidechaintilt", "bands", "crossoverlow", "crossoverhigh",
+    "autoattack", "autorelease", "detector"
+};
 
 GlobeLoveler::GlobeLoveler()
-    : AudioProcessor(),
+    : AudioProcessor(BusesProperties()
+                         .withInput("Input", AudioChannelSet::stereo(), true)
+                         .withInput("Sidechain", AudioChannelSet::stereo(), false)
+                         .withOutput("Output", AudioChannelSet::stereo(), true)),
     parameters(*this, nullptr, "PARAMETERS", createParameterLayout())
 {
     // Compressor parameters -KGK
-    // Add parameter listeners
-    parameters.addParameterListener("inputgain", this);
-    parameters.addParameterListener("makeup", this);
-    parameters.addParameterListener("threshold", this);
-    parameters.addParameterListener("ratio", this);
-    parameters.addParameterListener("knee", this);
-    parameters.addParameterListener("attack", this);
-    parameters.addParameterListener("release", this);
-    parameters.addParameterListener("mix", this);
+    // Resolve parameter atomics, processBlock reads these instead of listening for changes
+    for (int i = 0; i < numParameters; ++i)
+    {
+        parameterValues[i] = parameters.getRawParameterValue(parameterIDs[i]);
+        jassert(parameterValues[i] != nullptr);
+    }
+    appliedParameterValues.fill(std::numeric_limits<float>::quiet_NaN());
 
     gainReduction.set(0.0f);
     currentInput.set(-std::numeric_limits<float>::infinity());
     currentOutput.set(-std::numeric_limits<float>::infinity());
+
+    // Latency changes of the audio thread reach the host within latencyPollIntervalInMs
+    startTimer(latencyPollIntervalInMs);
 }
 
 //==============================================================================
 GlobeLoveler::~GlobeLoveler()
 {
+    stopTimer();
+
+    // Prints what the audio thread allocated or locked when built with GLOBE_LOVELER_RT_ASSERTIONS
+    RealtimeSafety::dumpReport();
 }
 
 //==============================================================================
@@ -81,7 +101,8 @@ bool GlobeLoveler::isMidiEffect() const
 //==============================================================================
 double GlobeLoveler::getTailLengthSeconds() const
 {
-    return 0.0;
+    // Input still inside the lookahead delay comes out after the host stops feeding us
+    return globeSampleRate > 0.0 ? getLatencySamples() / globeSampleRate : 0.0;
 }
 
 //==============================================================================
@@ -121,8 +142,17 @@ void GlobeLoveler::prepareToPlay(double sampleRate, int samplesPerBlock)
     DBG(String::formatted("Sample rate set to %f", globeSampleRate));
     DBG(String::formatted("Samples per block set to %f", globeSamplesPerBlock));
 
-    // Prepare dsp classes
-    compressor.prepare({sampleRate, static_cast<uint32>(samplesPerBlock), 2});
+    // Prepare dsp classes for every channel the host may hand us
+    // The sidechain bus only feeds detection and is never prepared for
+    const auto numChannels = jmax(getMainBusNumInputChannels(), getMainBusNumOutputChannels());
+
+    // Hand over the current parameters first, prepare() then starts without ramping towards them
+    updateCompressorParameters();
+    compressor.prepare({sampleRate, static_cast<uint32>(samplesPerBlock), static_cast<uint32>(numChannels)});
+    compressor.setChannelGroups(createDetectionGroups(getChannelLayoutOfBus(false, 0)));
+    limiter.prepare({sampleRate, static_cast<uint32>(samplesPerBlock), static_cast<uint32>(numChannels)});
+    processingLatency = compressor.getLatencySamples() + (limiterEnabled ? limiter.getLatencySamples() : 0);
+    setLatencySamples(processingLatency);
     inLevelFollower.prepare(sampleRate);
     outLevelFollower.prepare(sampleRate);
 
@@ -131,6 +161,18 @@ void GlobeLoveler::prepareToPlay(double sampleRate, int samplesPerBlock)
     outLevelFollower.setPeakDecay(0.3f);
 }
 
+//==============================================================================
+int64 GlobeLoveler::getSettlingSamples(float maxErrorInDecibels) const
+{
+    const auto compressorSettling = compressor.getSettlingSamples(maxErrorInDecibels);
+    return limiterEnabled ? jmax(compressorSettling, limiter.getSettlingSamples(maxErrorInDecibels)) : compressorSettling;
+}
+
+void GlobeLoveler::setParallelBands(bool shouldBeParallel)
+{
+    compressor.setParallelBands(shouldBeParallel);
+}
+
 //==============================================================================
 void GlobeLoveler::releaseResources()
 {
@@ -142,59 +184,148 @@ void GlobeLoveler::releaseResources()
 #ifndef JucePlugin_PreferredChannelConfigurations
 bool GlobeLoveler::isBusesLayoutSupported(const BusesLayout& layouts) const
 {
-    // Support mono, stereo, and disabled output channels -KGK
-    if (layouts.getMainOutputChannelSet() != AudioChannelSet::mono()
-        && layouts.getMainOutputChannelSet() != AudioChannelSet::stereo()
-        && layouts.getMainOutputChannelSet() != AudioChannelSet::disabled())
-        return false;
-    return true;
+    const auto& mainInput = layouts.getMainInputChannelSet();
+    const auto& mainOutput = layouts.getMainOutputChannelSet();
+
+    // The sidechain key may be mono, or match the main input channel for channel
+    if (layouts.inputBuses.size() > 1)
+    {
+        const auto& sidechain = layouts.getChannelSet(true, 1);
+        if (!sidechain.isDisabled() && sidechain != AudioChannelSet::mono() && sidechain != mainInput)
+            return false;
+    }
+
+    // Support disabled output channels -KGK
+    if (mainOutput == AudioChannelSet::disabled())
+        return true;
+
+    // Mono input is upmixed to stereo output
+    if (mainInput == AudioChannelSet::mono() && mainOutput == AudioChannelSet::stereo())
+        return true;
+
+    // Anything else, mono up to immersive layouts, is processed channel for channel
+    return mainInput == mainOutput;
 }
 #endif
 
+//==============================================================================
+std::vector<int> GlobeLoveler::createDetectionGroups(const AudioChannelSet& layout)
+{
+    enum Group { front, centre, lfe, surround, height };
+
+    std::vector<int> groups;
+    for (const auto type : layout.getChannelTypes())
+    {
+        switch (type)
+        {
+        case AudioChannelSet::centre:
+            groups.push_back(centre);
+            break;
+        case AudioChannelSet::LFE:
+        case AudioChannelSet::LFE2:
+            groups.push_back(lfe);
+            break;
+        case AudioChannelSet::leftSurround:
+        case AudioChannelSet::rightSurround:
+        case AudioChannelSet::centreSurround:
+        case AudioChannelSet::leftSurroundSide:
+        case AudioChannelSet::rightSurroundSide:
+        case AudioChannelSet::leftSurroundRear:
+        case AudioChannelSet::rightSurroundRear:
+        case AudioChannelSet::wideLeft:
+        case AudioChannelSet::wideRight:
+            groups.push_back(surround);
+            break;
+        case AudioChannelSet::topMiddle:
+        case AudioChannelSet::topFrontLeft:
+        case AudioChannelSet::topFrontCentre:
+        case AudioChannelSet::topFrontRight:
+        case AudioChannelSet::topRearLeft:
+        case AudioChannelSet::topRearCentre:
+        case AudioChannelSet::topRearRight:
+        case AudioChannelSet::topSideLeft:
+        case AudioChannelSet::topSideRight:
+            groups.push_back(height);
+            break;
+        default:
+            groups.push_back(front);
+            break;
+        }
+    }
+    return groups;
+}
+
 //==============================================================================
 void GlobeLoveler::processBlock(AudioBuffer<float>& buffer, MidiBuffer& midiMessages)
 {
+    RealtimeSafety::ScopedRealtimeSection realtimeSection;
     ScopedNoDenormals noDenormals;
-    auto totalNumInputChannels = getTotalNumInputChannels();
-    auto totalNumOutputChannels = getTotalNumOutputChannels();
+    updateCompressorParameters();
+    auto totalNumInputChannels = getMainBusNumInputChannels();
+    auto totalNumOutputChannels = getMainBusNumOutputChannels();
     const auto numSamples = buffer.getNumSamples();
 
-    // Cull output channels
-    for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
-        buffer.clear(i, 0, buffer.getNumSamples());
+    // The key shares channels with the outputs beyond the main input, so it's consumed before they're culled
+    const auto sidechainChannels = getBusCount(true) > 1 ? getChannelCountOfBus(true, 1) : 0;
+    const bool useSidechain = externalSidechain && sidechainChannels > 0;
 
-    // Map mono input to stereo input -KGK
-    if (totalNumOutputChannels == 2 && totalNumInputChannels == 1) {
-        buffer.setSize(2, numSamples, true, true, false);
-        buffer.copyFrom(1, 0, buffer, 0, 0, numSamples);
-        DBG("Copied channel 0 into channel 1");
-    }
+    // The host buffer always holds max(inputs, outputs) channels, so mono input is upmixed
+    // by compressing channel 0 alone and copying it over, the buffer is never resized -KGK
+    const bool upmixMono = totalNumOutputChannels == 2 && totalNumInputChannels == 1;
+    jassert(buffer.getNumChannels() >= jmax(totalNumInputChannels, totalNumOutputChannels));
 
     // Update input peak metering
     inLevelFollower.updatePeak(buffer.getArrayOfReadPointers(), totalNumInputChannels, numSamples);
     currentInput.set(Decibels::gainToDecibels(inLevelFollower.getPeak()));
 
-    // Do compressor processing
-    compressor.process(buffer);
+    // Do compressor processing, a view onto the input channels doesn't allocate
+    AudioBuffer<float> inputChannels(buffer.getArrayOfWritePointers(), totalNumInputChannels, numSamples);
+    if (useSidechain)
+        compressor.process(inputChannels, getBusBuffer(buffer, true, 1));
+    else
+        compressor.process(inputChannels);
+
+    // Optional true-peak ceiling, its reduction adds to the compressor's on the meter
+    float limiterGainReduction = 0.0f;
+    if (limiterEnabled)
+    {
+        limiter.process(inputChannels);
+        limiterGainReduction = limiter.getMaxGainReduction();
+    }
+
+    // Cull output channels
+    for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
+        buffer.clear(i, 0, buffer.getNumSamples());
+
+    if (upmixMono)
+        buffer.copyFrom(1, 0, buffer, 0, 0, numSamples);
 
     // Update gain reduction metering
-    gainReduction.set(compressor.getMaxGainReduction());
+    gainReduction.set(compressor.getMaxGainReduction() + limiterGainReduction);
 
     // Update output peak metering
-    outLevelFollower.updatePeak(buffer.getArrayOfReadPointers(), totalNumInputChannels, numSamples);
+    outLevelFollower.updatePeak(buffer.getArrayOfReadPointers(), totalNumOutputChannels, numSamples);
     currentOutput = Decibels::gainToDecibels(outLevelFollower.getPeak());
 }
 
 //==============================================================================
 AudioProcessorEditor* GlobeLoveler::createEditor()
 {
+#if GLOBE_LOVELER_HEADLESS
+    return nullptr;
+#else
     return new GlobeLovelerEditor(*this, parameters);
+#endif
 }
 
 //==============================================================================
 bool GlobeLoveler::hasEditor() const
 {
+#if GLOBE_LOVELER_HEADLESS
+    return false;
+#else
     return true;
+#endif
 }
 
 //==============================================================================
@@ -208,7 +339,12 @@ void GlobeLoveler::getStateInformation(MemoryBlock& destData)
     // Create the status element
     std::unique_ptr<juce::XmlElement> statusElement = std::make_unique<juce::XmlElement>("STATUS");
     // * Add version number to status
-    statusElement.get()->setAttribute("version", JUCEApplication::getInstance()->getApplicationVersion());
+    // * There is no JUCEApplication in headless builds, the standalone app reports the same string
+    #if GLOBE_LOVELER_HEADLESS
+        statusElement.get()->setAttribute("version", JucePlugin_VersionString);
+    #else
+        statusElement.get()->setAttribute("version", JUCEApplication::getInstance()->getApplicationVersion());
+    #endif
     // * Add release type to status, "Release" or "Debug" (should change to "Development" -KGK
     #ifndef JUCE_DEBUG
         statusElement.get()->setAttribute("release", "Release");
@@ -262,18 +398,102 @@ AudioProcessor* JUCE_CALLTYPE createPluginFilter()
 }
 
 //==============================================================================
-void GlobeLoveler::parameterChanged(const String& parameterID, float newValue)
+void GlobeLoveler::updateCompressorParameters()
+{
+    for (int i = 0; i < numParameters; ++i)
+    {
+        const float value = parameterValues[i]->load(std::memory_order_relaxed);
+        if (value != appliedParameterValues[i])
+        {
+            appliedParameterValues[i] = value;
+            applyCompressorParameter(i, value);
+        }
+    }
+}
+
+//==============================================================================
+void GlobeLoveler::applyCompressorParameter(int index, float value)
+{
+    switch (index)
+    {
+    case inputGainParameter: compressor.setInput(value); break;
+    case thresholdParameter: compressor.setThreshold(value); break;
+    case ratioParameter: compressor.setRatio(value); break;
+    case kneeParameter: compressor.setKnee(value); break;
+    case attackParameter: compressor.setAttack(value); break;
+    case releaseParameter: compressor.setRelease(value); break;
+    case makeupParameter: compressor.setMakeup(value); break;
+    case mixParameter: compressor.setMix(value); break;
+    case detectionParameter:
+        compressor.setDetectionMode(static_cast<Compressor::DetectionMode>(static_cast<int>(value)));
+        break;
+    case lookaheadParameter:
+        compressor.setLookahead(value);
+        updateLatency();
+        break;
+    case limiterParameter:
+        // Starts from a clear delay line instead of whatever it held when switched off
+        limiterEnabled = value >= 0.5f;
+        limiter.reset();
+        updateLatency();
+        break;
+    case ceilingParameter: limiter.setCeiling(value); break;
+    case limiterReleaseParameter: limiter.setRelease(value); break;
+    case oversamplingParameter:
+    case oversamplingPhaseParameter:
+        applyOversampling();
+        break;
+    case sidechainParameter: externalSidechain = value >= 0.5f; break;
+    case sidechainHighPassParameter: compressor.setSidechainHighPass(value); break;
+    case sidechainTiltParameter: compressor.setSidechainTilt(value); break;
+    case bandsParameter: compressor.setNumBands(value >= 1.0f ? static_cast<int>(value) + 2 : 1); break;
+    case crossoverLowParameter:
+    case crossoverHighParameter:
+        applyCrossovers();
+        break;
+    case autoAttackParameter: compressor.setAutoAttack(value >= 0.5f); break;
+    case autoReleaseParameter: compressor.setAutoRelease(value >= 0.5f); break;
+    case detectorParameter:
+        compressor.setDetectorTopology(static_cast<LevelDetector::Topology>(static_cast<int>(value)));
+        break;
+    default: jassertfalse; break;
+    }
+}
+
+void GlobeLoveler::applyOversampling()
+{
+    // The first update applies the factor while the phase is still NaN, linear phase until it follows
+    const auto factorIndex = appliedParameterValues[oversamplingParameter];
+    const auto phaseIndex = appliedParameterValues[oversamplingPhaseParameter];
+    const int factor = std::isnan(factorIndex) ? 1 : 1 << jlimit(0, 3, static_cast<int>(factorIndex));
+
+    compressor.setOversampling(factor, !(phaseIndex >= 0.5f));
+    updateLatency();
+}
+
+void GlobeLoveler::applyCrossovers()
+{
+    // Until both have been applied once the other one keeps its default
+    const auto low = appliedParameterValues[crossoverLowParameter];
+    const auto high = appliedParameterValues[crossoverHighParameter];
+
+    compressor.setCrossovers(std::isnan(low) ? Constants::Parameter::crossoverLowDefault : low,
+                             std::isnan(high) ? Constants::Parameter::crossoverHighDefault : high);
+}
+
+//==============================================================================
+void GlobeLoveler::updateLatency()
 {
-    // Compressor parameters
-    if (parameterID == "inputgain") compressor.setInput(newValue);
-    else if (parameterID == "threshold") compressor.setThreshold(newValue);
-    else if (parameterID == "ratio") compressor.setRatio(newValue);
-    else if (parameterID == "knee") compressor.setKnee(newValue);
-    else if (parameterID == "attack") compressor.setAttack(newValue);
-    else if (parameterID == "release") compressor.setRelease(newValue);
-    else if (parameterID == "makeup") compressor.setMakeup(newValue);
-    else if (parameterID == "mix") compressor.setMix(newValue);
-	DBG("Received unknown parameter " + parameterID);
+    // setLatencySamples notifies the host under a lock, timerCallback hands it over on the message thread
+    processingLatency = compressor.getLatencySamples() + (limiterEnabled ? limiter.getLatencySamples() : 0);
+}
+
+//==============================================================================
+void GlobeLoveler::timerCallback()
+{
+    const int latency = processingLatency;
+    if (latency != getLatencySamples())
+        setLatencySamples(latency);
 }
 
 //==============================================================================
@@ -380,6 +600,111 @@ AudioProcessorValueTreeState::ParameterLayout GlobeLoveler::createParameterLayou
                                                            {
                                                                return String(value * 100.0f, 1) + " %";
                                                            }));
+
+    params.push_back(std::make_unique<AudioParameterChoice>("detection", "Detection",
+                                                            StringArray{"Max Linked", "RMS Linked",
+                                                                        "Unlinked", "Grouped"}, 0));
+
+    params.push_back(std::make_unique<AudioParameterFloat>("lookahead", "Lookahead",
+                                                           NormalisableRange<float>(
+                                                               Constants::Parameter::lookaheadStart,
+                                                               Constants::Parameter::lookaheadEnd,
+                                                               Constants::Parameter::lookaheadInterval),
+                                                           0.0f, "ms", AudioProcessorParameter::genericParameter,
+                                                           [](float value, float)
+                                                           {
+                                                               return String(value, 2) + " ms";
+                                                           }));
+
+    params.push_back(std::make_unique<AudioParameterBool>("limiter", "Limiter", false));
+
+    params.push_back(std::make_unique<AudioParameterFloat>("ceiling", "Ceiling",
+                                                           NormalisableRange<float>(
+                                                               Constants::Parameter::ceilingStart,
+                                                               Constants::Parameter::ceilingEnd,
+                                                               Constants::Parameter::ceilingInterval),
+                                                           -1.0f, String(), AudioProcessorParameter::genericParameter,
+                                                           [](float value, float)
+                                                           {
+                                                               return String(value, 1) + " dBTP";
+                                                           }));
+
+    params.push_back(std::make_unique<AudioParameterFloat>("limiterrelease", "Limiter Release",
+                                                           NormalisableRange<float>(
+                                                               Constants::Parameter::limiterReleaseStart,
+                                                               Constants::Parameter::limiterReleaseEnd,
+                                                               Constants::Parameter::limiterReleaseInterval, 0.5f),
+                                                           50.0f, String(), AudioProcessorParameter::genericParameter,
+                                                           [](float value, float)
+                                                           {
+                                                               return String(value, 1) + " ms";
+                                                           }));
+
+    params.push_back(std::make_unique<AudioParameterChoice>("oversampling", "Oversampling",
+                                                            StringArray{"Off", "2x", "4x", "8x"}, 0));
+
+    params.push_back(std::make_unique<AudioParameterChoice>("oversamplingphase", "Oversampling Phase",
+                                                            StringArray{"Linear Phase", "Minimum Phase"}, 0));
+
+    params.push_back(std::make_unique<AudioParameterBool>("sidechain", "External Sidechain", false));
+
+    params.push_back(std::make_unique<AudioParameterFloat>("sidechainhighpass", "Sidechain High-Pass",
+                                                           NormalisableRange<float>(
+                                                               Constants::Parameter::sidechainHighPassStart,
+                                                               Constants::Parameter::sidechainHighPassEnd,
+                                                               Constants::Parameter::sidechainHighPassInterval,
+                                                               0.5f),
+                                                           0.0f, String(), AudioProcessorParameter::genericParameter,
+                                                           [](float value, float)
+                                                           {
+                                                               return value > 0.0f ? String(value, 0) + " Hz" : String("Off");
+                                                           }));
+
+    params.push_back(std::make_unique<AudioParameterFloat>("sidechaintilt", "Sidechain Tilt",
+                                                           NormalisableRange<float>(
+                                                               Constants::Parameter::sidechainTiltStart,
+                                                               Constants::Parameter::sidechainTiltEnd,
+                                                               Constants::Parameter::sidechainTiltInterval),
+                                                           0.0f, String(), AudioProcessorParameter::genericParameter,
+                                                           [](float value, float)
+                                                           {
+                                                               return String(value, 1) + " dB";
+                                                           }));
+
+    params.push_back(std::make_unique<AudioParameterChoice>("bands", "Bands",
+                                                            StringArray{"Off", "3", "4", "5"}, 0));
+
+    params.push_back(std::make_unique<AudioParameterFloat>("crossoverlow", "Low Crossover",
+                                                           NormalisableRange<float>(
+                                                               Constants::Parameter::crossoverLowStart,
+                                                               Constants::Parameter::crossoverLowEnd,
+                                                               Constants::Parameter::crossoverInterval, 0.3f),
+                                                           Constants::Parameter::crossoverLowDefault, String(),
+                                                           AudioProcessorParameter::genericParameter,
+                                                           [](float value, float)
+                                                           {
+                                                               return String(value, 0) + " Hz";
+                                                           }));
+
+    params.push_back(std::make_unique<AudioParameterFloat>("crossoverhigh", "High Crossover",
+                                                           NormalisableRange<float>(
+                                                               Constants::Parameter::crossoverHighStart,
+                                                               Constants::Parameter::crossoverHighEnd,
+                                                               Constants::Parameter::crossoverInterval, 0.3f),
+                                                           Constants::Parameter::crossoverHighDefault, String(),
+                                                           AudioProcessorParameter::genericParameter,
+                                                           [](float value, float)
+                                                           {
+                                                               return String(value, 0) + " Hz";
+                                                           }));
+
+    params.push_back(std::make_unique<AudioParameterBool>("autoattack", "Auto Attack", false));
+
+    params.push_back(std::make_unique<AudioParameterBool>("autorelease", "Auto Release", false));
+
+    params.push_back(std::make_unique<AudioParameterChoice>("detector", "Detector",
+                                                            StringArray{"Peak", "Peak Decoupled",
+                                                                        "RMS", "Peak/RMS"}, 0));
    
     return {params.begin(), params.end()};
 }
@@ -16,11 +16,48 @@
 
 #include "dsp/include/Compressor.h"
 #include "dsp/include/LevelEnvelopeFollower.h"
+#include "dsp/include/TruePeakLimiter.h"
 
 //==============================================================================
-class GlobeLoveler : public AudioProcessor, public AudioProcessorValueTreeState::Listener, juce::ChangeBroadcaster
+class GlobeLoveler : public AudioProcessor, juce::ChangeBroadcaster, private Timer
 {
 public:
+    // Compressor parameters, the index is fixed at construction and used on the audio thread instead of the ID
+    enum ParameterIndex
+    {
+        inputGainParameter,
+        thresholdParameter,
+        ratioParameter,
+        kneeParameter,
+        attackParameter,
+        releaseParameter,
+        makeupParameter,
+        mixParameter,
+        detectionParameter,
+        lookaheadParameter,
+        limiterParameter,
+        ceilingParameter,
+        limiterReleaseParameter,
+        oversamplingParameter,
+        oversamplingPhaseParameter,
+        sidechainParameter,
+        sidechainHighPassParameter,
+        sidechainTiltParameter,
+        bandsParameter,
+        crossoverLowParameter,
+        crossoverHighParameter,
+        autoAttackParameter,
+        autoReleaseParameter,
+        detectorParameter,
+        numParameters
+    };
+
+    // Parameter IDs in ParameterIndex order
+    static const char* const parameterIDs[numParameters];
+
+    // How often the message thread checks for a latency change of the audio thread
+    static constexpr int latencyPollIntervalInMs = 50;
+
     //==============================================================================
     GlobeLoveler();
     ~GlobeLoveler();
@@ -56,10 +93,17 @@ public:
     //==============================================================================
     void getStateInformation(MemoryBlock& destData) override;
     void setStateInformation(const void* data, int sizeInBytes) override;
-    void parameterChanged(const String& parameterID, float newValue) override;
 
     AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
     
+    // Samples of pre-roll after which a fresh instance matches a running one within maxErrorInDecibels,
+    // valid after prepareToPlay for the current parameters
+    int64 getSettlingSamples(float maxErrorInDecibels) const;
+
+    // Splits large multiband blocks across one thread per band. Blocks the audio thread while they run,
+    // for offline rendering only
+    void setParallelBands(bool);
+
     //==============================================================================
     Atomic<float> gainReduction;
     Atomic<float> currentInput;
@@ -67,6 +111,23 @@ public:
 
 //==============================================================================
 private:
+    // Detection groups for DetectionMode::grouped: front L/R, centre, LFE, surrounds and heights
+    static std::vector<int> createDetectionGroups(const AudioChannelSet& layout);
+
+    // Takes one snapshot of the parameter atomics per block and forwards changed values to the compressor
+    void updateCompressorParameters();
+    void applyCompressorParameter(int index, float value);
+    // Factor and filter phase are two parameters but one compressor setting
+    void applyOversampling();
+    // Both crossover parameters set one band split
+    void applyCrossovers();
+
+    // Latency of compressor and limiter, only stored: the audio thread must not post to the message queue
+    void updateLatency();
+
+    // Reports a latency change of the audio thread to the host, polled on the message thread
+    void timerCallback() override;
+
     BusesProperties Properties;     // Declare BusesProperities member (unitialized) -KGK
     BusesLayout Layouts;            // Declare the BusesLayouts member (unused) -KGK
 
@@ -76,8 +137,18 @@ private:
     // Parameters must be initialized AFTER parameter names -KGK
     AudioProcessorValueTreeState parameters;
 
+    // Atomics published by the parameters, resolved once in the constructor
+    std::array<std::atomic<float>*, numParameters> parameterValues{};
+    // Values last handed to the compressor, audio thread only. NaN forces an update
+    std::array<float, numParameters> appliedParameterValues{};
+    // Latency after the last lookahead, oversampling or limiter change, picked up by timerCallback
+    std::atomic<int> processingLatency{0};
+
     //==============================================================================
     Compressor compressor;
+    TruePeakLimiter limiter;
+    bool limiterEnabled{false};
+    bool externalSidechain{false};
 
     // Reverb object -KGK
     #if GLOBE_REVERB
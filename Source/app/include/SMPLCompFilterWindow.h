@@ -40,6 +40,7 @@
 #include <JuceHeader.h>
 #include "../Source/gui/include/SMPLCompStandaloneInfoPopup.h"
 #include "../Source/gui/include/SMPLCompStandaloneLookAndFeel.h"
+#include "../Source/util/RealtimeSafety.h"
 
 #ifndef DOXYGEN
  #include <juce_audio_plugin_client/detail/juce_CreatePluginFilter.h>
@@ -659,10 +660,16 @@ private:
                                            int numSamples,
                                            const AudioIODeviceCallbackContext& context) override
     {
-        if (muteInput)
         {
-            emptyBuffer.clear();
-            inputChannelData = emptyBuffer.getArrayOfReadPointers();
+            // AudioProcessorPlayer locks its own and the processor's callback lock below,
+            // processBlock opens its own section inside them
+            RealtimeSafety::ScopedRealtimeSection realtimeSection;
+
+            if (muteInput)
+            {
+                emptyBuffer.clear();
+                inputChannelData = emptyBuffer.getArrayOfReadPointers();
+            }
         }
 
         player.audioDeviceIOCallbackWithContext (inputChannelData,
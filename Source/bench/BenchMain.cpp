@@ -0,0 +1,142 @@
+/*
+  ==============================================================================
+    File:           BenchMain.cpp
+    Developers:     D. Robert Hoover and Kris Keillor
+    Repository URL: https://github.com/Top-Notch-DSP/GlobeLoveler
+    Date:           2024 Feb 1
+    License:        GNU General Public License, version 3.0 (GPL-3.0)
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include <iomanip>
+#include <iostream>
+#include "include/DspBenchmark.h"
+#include "include/GoldenReference.h"
+
+namespace
+{
+    const char* const usage =
+        "GlobeLovelerBench [--output <file.json>] [--baseline <file.json>] [--tolerance <percent>] [--filter <stage>] [--quick]\n"
+        "GlobeLovelerBench --write-references <dir> | --verify <dir> [--max-error-dbfs <dB>]\n"
+        "  --output     writes every measurement as JSON, use it as a later --baseline\n"
+        "  --baseline   compares against an earlier --output, exits with 1 on regressions\n"
+        "  --tolerance  slowdown in percent that counts as a regression, default 10\n"
+        "  --filter     only stages whose name contains the text, e.g. Compressor\n"
+        "  --quick      block sizes 64, 512 and 4096 at 48 kHz stereo only\n"
+        "  --write-references  renders the test signals through the exact scalar path into <dir>\n"
+        "  --verify     renders every processing path and compares it to the references in <dir>,\n"
+        "               exits with 1 if any sample is off by more than --max-error-dbfs, default -100";
+
+    File getDirectory(ArgumentList& args, StringRef option)
+    {
+        return File::getCurrentWorkingDirectory().getChildFile(args.removeValueForOption(option));
+    }
+
+    void writeReferences(const ArgumentList& arguments)
+    {
+        auto args = arguments;
+        const auto directory = getDirectory(args, "--write-references");
+
+        const auto result = GoldenReference::writeReferences(directory);
+        if (result.failed())
+            ConsoleApplication::fail(result.getErrorMessage());
+
+        std::cout << "References written to " << directory.getFullPathName() << std::endl;
+    }
+
+    void verifyReferences(const ArgumentList& arguments)
+    {
+        auto args = arguments;
+        const auto directory = getDirectory(args, "--verify");
+
+        float maxErrorInDbfs = -100.0f;
+        if (args.containsOption("--max-error-dbfs"))
+            maxErrorInDbfs = args.removeValueForOption("--max-error-dbfs").getFloatValue();
+
+        if (!directory.isDirectory())
+            ConsoleApplication::fail("Could not find " + directory.getFullPathName());
+
+        const auto comparisons = GoldenReference::verify(directory, maxErrorInDbfs);
+        if (GoldenReference::printReport(comparisons, std::cout) > 0)
+            ConsoleApplication::fail("Output deviates from the references", 1);
+    }
+
+    void runBenchmark(const ArgumentList& arguments)
+    {
+        auto args = arguments;
+        DspBenchmark::Settings settings;
+
+        File outputFile, baselineFile;
+        if (args.containsOption("--output"))
+            outputFile = File::getCurrentWorkingDirectory().getChildFile(args.removeValueForOption("--output"));
+        if (args.containsOption("--baseline"))
+            baselineFile = File::getCurrentWorkingDirectory().getChildFile(args.removeValueForOption("--baseline"));
+
+        double tolerancePercent = 10.0;
+        if (args.containsOption("--tolerance"))
+            tolerancePercent = args.removeValueForOption("--tolerance").getDoubleValue();
+        if (tolerancePercent < 0.0)
+            ConsoleApplication::fail("--tolerance must not be negative");
+
+        if (args.containsOption("--filter"))
+            settings.filter = args.removeValueForOption("--filter");
+
+        if (args.removeOptionIfFound("--quick"))
+        {
+            settings.blockSizes = {64, 512, 4096};
+            settings.sampleRates = {48000.0};
+            settings.channelCounts = {2};
+        }
+
+        for (const auto& argument : args.arguments)
+            ConsoleApplication::fail("Unknown argument " + argument.text);
+
+        // Read the baseline first, a bad path should not cost a whole run
+        std::vector<DspBenchmark::Measurement> baseline;
+        if (baselineFile != File())
+        {
+            if (!baselineFile.existsAsFile())
+                ConsoleApplication::fail("Could not find " + baselineFile.getFullPathName());
+            baseline = DspBenchmark::fromJson(JSON::parse(baselineFile));
+            if (baseline.empty())
+                ConsoleApplication::fail("No measurements in " + baselineFile.getFullPathName());
+        }
+
+        std::cout << SystemStats::getCpuModel() << ", " << (DspBenchmark::hasCycleCounter() ? "ns and TSC cycles" : "ns")
+                  << " per sample\n" << std::fixed;
+
+        DspBenchmark benchmark(settings);
+        const auto results = benchmark.run([](const DspBenchmark::Measurement& measurement) {
+            std::cout << std::left << std::setw(48) << measurement.stage << std::right
+                      << std::setw(6) << measurement.blockSize
+                      << std::setw(8) << roundToInt(measurement.sampleRate)
+                      << std::setw(3) << measurement.numChannels
+                      << std::setw(10) << std::setprecision(3) << measurement.nsPerSample;
+            if (measurement.cyclesPerSample >= 0.0)
+                std::cout << std::setw(10) << std::setprecision(2) << measurement.cyclesPerSample;
+            std::cout << std::endl;
+        });
+
+        if (outputFile != File() && !outputFile.replaceWithText(JSON::toString(DspBenchmark::toJson(results))))
+            ConsoleApplication::fail("Could not write " + outputFile.getFullPathName());
+
+        if (!baseline.empty() && DspBenchmark::compare(results, baseline, tolerancePercent, std::cout) > 0)
+            ConsoleApplication::fail("Performance regressed against " + baselineFile.getFileName(), 1);
+    }
+}
+
+//==============================================================================
+int main(int argc, char* argv[])
+{
+    ConsoleApplication app;
+    app.addHelpCommand("--help|-h", usage, false);
+    app.addCommand({"--write-references", "--write-references <dir>", "Stores the golden reference renders", {},
+                    [](const ArgumentList& args) { writeReferences(args); }});
+    app.addCommand({"--verify", "--verify <dir> [--max-error-dbfs <dB>]", "Compares every processing path to the references", {},
+                    [](const ArgumentList& args) { verifyReferences(args); }});
+    app.addDefaultCommand({"", usage, "Times every DSP stage of GlobeLoveler", {},
+                           [](const ArgumentList& args) { runBenchmark(args); }});
+
+    return app.findAndRunCommand(argc, argv);
+}
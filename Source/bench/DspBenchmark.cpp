@@ -0,0 +1,438 @@
+/*
+  ==============================================================================
+    File:           DspBenchmark.cpp
+    Developers:     D. Robert Hoover and Kris Keillor
+    Repository URL: https://github.com/Top-Notch-DSP/GlobeLoveler
+    Date:           2024 Feb 1
+    License:        GNU General Public License, version 3.0 (GPL-3.0)
+  ==============================================================================
+*/
+
+#include "include/DspBenchmark.h"
+#include "../dsp/include/Compressor.h"
+#include "../dsp/include/GainComputer.h"
+#include "../dsp/include/LevelDetector.h"
+#include "../dsp/include/LevelEnvelopeFollower.h"
+#include "../dsp/include/SidechainFilter.h"
+#include "../dsp/include/VectorKernels.h"
+#include <map>
+#include <iomanip>
+
+#if JUCE_INTEL && (JUCE_GCC || JUCE_CLANG)
+    #include <x86intrin.h>
+    #define DSP_BENCHMARK_TSC 1
+#elif JUCE_INTEL && JUCE_MSVC
+    #include <intrin.h>
+    #define DSP_BENCHMARK_TSC 1
+#endif
+
+namespace
+{
+    inline uint64 readCycleCounter()
+    {
+#if DSP_BENCHMARK_TSC
+        return __rdtsc();
+#else
+        return 0;
+#endif
+    }
+
+    // Noise with a slow envelope, so the compressor moves between attack, release and idle
+    void fillTestSignal(float* dest, int numSamples, int seed)
+    {
+        Random random(seed);
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const float envelope = 0.5f + 0.5f * std::sin(static_cast<float>(i) * 0.0007f);
+            dest[i] = envelope * (random.nextFloat() * 2.0f - 1.0f);
+        }
+    }
+
+    // Stops the optimiser from dropping results nobody reads
+    volatile float sink = 0.0f;
+}
+
+//==============================================================================
+String DspBenchmark::Measurement::getKey() const
+{
+    return stage + "|" + String(blockSize) + "|" + String(roundToInt(sampleRate)) + "|" + String(numChannels);
+}
+
+DspBenchmark::DspBenchmark(const Settings& benchmarkSettings)
+    : settings(benchmarkSettings)
+{
+}
+
+bool DspBenchmark::hasCycleCounter()
+{
+#if DSP_BENCHMARK_TSC
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool DspBenchmark::isSelected(const String& stage) const
+{
+    return settings.filter.isEmpty() || stage.containsIgnoreCase(settings.filter);
+}
+
+template <typename Restore, typename Body>
+DspBenchmark::Measurement DspBenchmark::measure(const String& stage, int blockSize, double sampleRate,
+                                                int numChannels, Restore&& restore, Body&& body) const
+{
+    struct Timing
+    {
+        double seconds;
+        double cycles;
+    };
+
+    auto runLoop = [&](int64 iterations, bool withBody) {
+        const auto startCycles = readCycleCounter();
+        const auto startTicks = Time::getHighResolutionTicks();
+        for (int64 i = 0; i < iterations; ++i)
+        {
+            restore();
+            if (withBody)
+                body();
+        }
+        const auto seconds = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - startTicks);
+        return Timing{seconds, static_cast<double>(readCycleCounter() - startCycles)};
+    };
+
+    // Grow the iteration count until one measurement lasts long enough to trust the clock
+    int64 iterations = 1;
+    while (runLoop(iterations, true).seconds < settings.secondsPerMeasurement && iterations < (int64(1) << 40))
+        iterations *= 2;
+
+    std::vector<double> nanoseconds, cycles;
+    for (int i = 0; i < jmax(1, settings.numMeasurements); ++i)
+    {
+        const auto total = runLoop(iterations, true);
+        const auto overhead = runLoop(iterations, false);
+        const auto samples = static_cast<double>(iterations) * blockSize * numChannels;
+        nanoseconds.push_back(jmax(0.0, total.seconds - overhead.seconds) * 1.0e9 / samples);
+        cycles.push_back(jmax(0.0, total.cycles - overhead.cycles) / samples);
+    }
+
+    auto median = [](std::vector<double>& values) {
+        std::nth_element(values.begin(), values.begin() + static_cast<long>(values.size() / 2), values.end());
+        return values[values.size() / 2];
+    };
+
+    Measurement measurement;
+    measurement.stage = stage;
+    measurement.blockSize = blockSize;
+    measurement.sampleRate = sampleRate;
+    measurement.numChannels = numChannels;
+    measurement.nsPerSample = median(nanoseconds);
+    measurement.cyclesPerSample = hasCycleCounter() ? median(cycles) : -1.0;
+    return measurement;
+}
+
+std::vector<DspBenchmark::Measurement> DspBenchmark::run(const std::function<void(const Measurement&)>& onMeasurement)
+{
+    // Same floating point environment as the plugin's processBlock
+    ScopedNoDenormals noDenormals;
+    std::vector<Measurement> results;
+
+    benchmarkGainComputer(results, onMeasurement);
+    benchmarkLevelDetector(results, onMeasurement);
+    benchmarkEnvelopeFollower(results, onMeasurement);
+    benchmarkSidechainFilter(results, onMeasurement);
+    benchmarkCompressor(results, onMeasurement);
+    return results;
+}
+
+//==============================================================================
+void DspBenchmark::benchmarkGainComputer(std::vector<Measurement>& results,
+                                         const std::function<void(const Measurement&)>& onMeasurement)
+{
+    // Stateless and independent of sample rate and channel count, one buffer per block size
+    const String vectorStage("GainComputer::applyCompressionToBuffer");
+    const String referenceStage("GainComputer::applyCompressionToBufferReference");
+
+    GainComputer gainComputer;
+    gainComputer.setThreshold(-20.0f);
+    gainComputer.setRatio(4.0f);
+    gainComputer.setKnee(6.0f);
+
+    for (const auto blockSize : settings.blockSizes)
+    {
+        std::vector<float> source(static_cast<size_t>(blockSize)), work(source.size());
+        fillTestSignal(source.data(), blockSize, 1);
+        for (auto& sample : source)
+            sample = std::abs(sample);
+
+        auto restore = [&] { FloatVectorOperations::copy(work.data(), source.data(), blockSize); };
+
+        for (const auto& stage : {vectorStage, referenceStage})
+        {
+            if (!isSelected(stage))
+                continue;
+
+            const bool reference = stage == referenceStage;
+            results.push_back(measure(stage, blockSize, 0.0, 1, restore, [&] {
+                if (reference)
+                    gainComputer.applyCompressionToBufferReference(work.data(), blockSize);
+                else
+                    gainComputer.applyCompressionToBuffer(work.data(), blockSize);
+            }));
+            if (onMeasurement)
+                onMeasurement(results.back());
+        }
+    }
+}
+
+void DspBenchmark::benchmarkLevelDetector(std::vector<Measurement>& results,
+                                          const std::function<void(const Measurement&)>& onMeasurement)
+{
+    // Speculative release runs against the per-sample branched detector
+    const String speculativeStage("LevelDetector::applyBallistics");
+    const String referenceStage("LevelDetector::applyBallisticsReference");
+
+    for (const auto sampleRate : settings.sampleRates)
+    {
+        for (const auto blockSize : settings.blockSizes)
+        {
+            // Attenuation in dB as the gain computer hands it over
+            GainComputer gainComputer;
+            gainComputer.setThreshold(-20.0f);
+            gainComputer.setRatio(4.0f);
+            std::vector<float> source(static_cast<size_t>(blockSize)), work(source.size());
+            fillTestSignal(source.data(), blockSize, 2);
+            for (auto& sample : source)
+                sample = std::abs(sample);
+            gainComputer.applyCompressionToBufferReference(source.data(), blockSize);
+
+            for (const auto& stage : {speculativeStage, referenceStage})
+            {
+                if (!isSelected(stage))
+                    continue;
+
+                LevelDetector detector;
+                detector.prepare(sampleRate);
+                detector.setAttack(0.002);
+                detector.setRelease(0.14);
+
+                const bool reference = stage == referenceStage;
+                results.push_back(measure(stage, blockSize, sampleRate, 1,
+                                          [&] { FloatVectorOperations::copy(work.data(), source.data(), blockSize); },
+                                          [&] {
+                                              if (reference)
+                                                  detector.applyBallisticsReference(work.data(), blockSize);
+                                              else
+                                                  detector.applyBallistics(work.data(), blockSize);
+                                          }));
+                if (onMeasurement)
+                    onMeasurement(results.back());
+            }
+        }
+    }
+}
+
+void DspBenchmark::benchmarkEnvelopeFollower(std::vector<Measurement>& results,
+                                             const std::function<void(const Measurement&)>& onMeasurement)
+{
+    const String peakStage("LevelEnvelopeFollower::updatePeak");
+    const String rmsStage("LevelEnvelopeFollower::updateRMS");
+
+    for (const auto sampleRate : settings.sampleRates)
+    {
+        for (const auto numChannels : settings.channelCounts)
+        {
+            for (const auto blockSize : settings.blockSizes)
+            {
+                // Read only, nothing to restore
+                AudioBuffer<float> buffer(numChannels, blockSize);
+                for (int ch = 0; ch < numChannels; ++ch)
+                    fillTestSignal(buffer.getWritePointer(ch), blockSize, 3 + ch);
+
+                LevelEnvelopeFollower follower;
+                follower.prepare(sampleRate);
+                follower.setPeakDecay(0.3f);
+                follower.setRmsDecay(0.3f);
+
+                const auto* const* channels = buffer.getArrayOfReadPointers();
+
+                if (isSelected(peakStage))
+                {
+                    results.push_back(measure(peakStage, blockSize, sampleRate, numChannels, [] {}, [&] {
+                        follower.updatePeak(channels, numChannels, blockSize);
+                        sink = follower.getPeak();
+                    }));
+                    if (onMeasurement)
+                        onMeasurement(results.back());
+                }
+
+                if (isSelected(rmsStage))
+                {
+                    results.push_back(measure(rmsStage, blockSize, sampleRate, numChannels, [] {}, [&] {
+                        follower.updateRMS(channels, numChannels, blockSize);
+                        sink = follower.getRMS();
+                    }));
+                    if (onMeasurement)
+                        onMeasurement(results.back());
+                }
+            }
+        }
+    }
+}
+
+void DspBenchmark::benchmarkSidechainFilter(std::vector<Measurement>& results,
+                                            const std::function<void(const Measurement&)>& onMeasurement)
+{
+    const String stage("SidechainFilter::process");
+    if (!isSelected(stage))
+        return;
+
+    for (const auto sampleRate : settings.sampleRates)
+    {
+        // Both sections on, the most it costs per channel
+        SidechainFilter filter;
+        filter.prepare(sampleRate, 1);
+        filter.setHighPass(100.0f);
+        filter.setTilt(3.0f);
+
+        for (const auto blockSize : settings.blockSizes)
+        {
+            std::vector<float> source(static_cast<size_t>(blockSize)), work(source.size());
+            fillTestSignal(source.data(), blockSize, 4);
+
+            results.push_back(measure(stage, blockSize, sampleRate, 1,
+                                      [&] { FloatVectorOperations::copy(work.data(), source.data(), blockSize); },
+                                      [&] { filter.process(0, work.data(), blockSize); }));
+            if (onMeasurement)
+                onMeasurement(results.back());
+        }
+    }
+}
+
+void DspBenchmark::benchmarkCompressor(std::vector<Measurement>& results,
+                                       const std::function<void(const Measurement&)>& onMeasurement)
+{
+    const String multiPassStage("Compressor::process");
+    const String fusedStage("Compressor::process (fused)");
+    const String multibandStage("Compressor::process (5 bands)");
+
+    for (const auto& stage : {multiPassStage, fusedStage, multibandStage})
+    {
+        if (!isSelected(stage))
+            continue;
+
+        for (const auto sampleRate : settings.sampleRates)
+        {
+            for (const auto numChannels : settings.channelCounts)
+            {
+                for (const auto blockSize : settings.blockSizes)
+                {
+                    // Parameters go in before prepare, otherwise the first calls time the parameter ramps
+                    Compressor compressor;
+                    compressor.setEngine(stage == fusedStage ? Compressor::Engine::fused : Compressor::Engine::multiPass);
+                    compressor.setThreshold(-24.0f);
+                    compressor.setRatio(4.0f);
+                    compressor.setKnee(6.0f);
+                    compressor.setAttack(2.0f);
+                    compressor.setRelease(140.0f);
+                    compressor.setMakeup(6.0f);
+                    compressor.setMix(0.8f);
+                    compressor.setNumBands(stage == multibandStage ? 5 : 1);
+                    compressor.prepare({sampleRate, static_cast<uint32>(blockSize), static_cast<uint32>(numChannels)});
+
+                    AudioBuffer<float> source(numChannels, blockSize), work(numChannels, blockSize);
+                    for (int ch = 0; ch < numChannels; ++ch)
+                        fillTestSignal(source.getWritePointer(ch), blockSize, 10 + ch);
+
+                    results.push_back(measure(stage, blockSize, sampleRate, numChannels,
+                                              [&] {
+                                                  for (int ch = 0; ch < numChannels; ++ch)
+                                                      work.copyFrom(ch, 0, source, ch, 0, blockSize);
+                                              },
+                                              [&] { compressor.process(work); }));
+                    if (onMeasurement)
+                        onMeasurement(results.back());
+                }
+            }
+        }
+    }
+}
+
+//==============================================================================
+var DspBenchmark::toJson(const std::vector<Measurement>& measurements)
+{
+    Array<var> cases;
+    for (const auto& measurement : measurements)
+    {
+        auto* object = new DynamicObject();
+        object->setProperty("stage", measurement.stage);
+        object->setProperty("blockSize", measurement.blockSize);
+        object->setProperty("sampleRate", measurement.sampleRate);
+        object->setProperty("channels", measurement.numChannels);
+        object->setProperty("nsPerSample", measurement.nsPerSample);
+        object->setProperty("cyclesPerSample", measurement.cyclesPerSample >= 0.0 ? var(measurement.cyclesPerSample) : var());
+        cases.add(var(object));
+    }
+
+    auto* root = new DynamicObject();
+    root->setProperty("cpu", SystemStats::getCpuModel());
+    root->setProperty("cpuCount", SystemStats::getNumCpus());
+    root->setProperty("instructionSet", String(VectorKernels::getInstructionSetName()));
+    root->setProperty("date", Time::getCurrentTime().toISO8601(true));
+    root->setProperty("results", cases);
+    return var(root);
+}
+
+std::vector<DspBenchmark::Measurement> DspBenchmark::fromJson(const var& json)
+{
+    std::vector<Measurement> measurements;
+    if (const auto* cases = json["results"].getArray())
+    {
+        for (const auto& item : *cases)
+        {
+            Measurement measurement;
+            measurement.stage = item["stage"].toString();
+            measurement.blockSize = item["blockSize"];
+            measurement.sampleRate = item["sampleRate"];
+            measurement.numChannels = item["channels"];
+            measurement.nsPerSample = item["nsPerSample"];
+            measurement.cyclesPerSample = item["cyclesPerSample"].isVoid() ? -1.0 : static_cast<double>(item["cyclesPerSample"]);
+            measurements.push_back(measurement);
+        }
+    }
+    return measurements;
+}
+
+int DspBenchmark::compare(const std::vector<Measurement>& current, const std::vector<Measurement>& baseline,
+                          double tolerancePercent, std::ostream& stream)
+{
+    std::map<String, const Measurement*> baselineByKey;
+    for (const auto& measurement : baseline)
+        baselineByKey[measurement.getKey()] = &measurement;
+
+    int numRegressions = 0, numImprovements = 0, numCompared = 0;
+    stream << std::fixed << std::setprecision(3);
+
+    for (const auto& measurement : current)
+    {
+        const auto found = baselineByKey.find(measurement.getKey());
+        if (found == baselineByKey.end() || found->second->nsPerSample <= 0.0)
+            continue;
+
+        ++numCompared;
+        const auto change = 100.0 * (measurement.nsPerSample / found->second->nsPerSample - 1.0);
+
+        if (change > tolerancePercent)
+        {
+            ++numRegressions;
+            stream << "REGRESSION  " << measurement.getKey() << "  " << found->second->nsPerSample << " -> "
+                   << measurement.nsPerSample << " ns/sample (+" << std::setprecision(1) << change << " %)\n"
+                   << std::setprecision(3);
+        }
+        else if (change < -tolerancePercent)
+            ++numImprovements;
+    }
+
+    stream << std::setprecision(1) << numCompared << " case(s) compared, " << numRegressions << " regression(s), " << numImprovements
+           << " improvement(s) beyond " << tolerancePercent << " %\n";
+    return numRegressions;
+}
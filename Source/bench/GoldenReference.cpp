@@ -0,0 +1,331 @@
+/*
+  ==============================================================================
+    File:           GoldenReference.cpp
+    Developers:     D. Robert Hoover and Kris Keillor
+    Repository URL: https://github.com/Top-Notch-DSP/GlobeLoveler
+    Date:           2024 Feb 1
+    License:        GNU General Public License, version 3.0 (GPL-3.0)
+  ==============================================================================
+*/
+
+#include "include/GoldenReference.h"
+#include "../dsp/include/Compressor.h"
+#include <iomanip>
+#include <iterator>
+
+namespace
+{
+    constexpr int signalLength = 2 * static_cast<int>(GoldenReference::sampleRate);
+
+    struct TestSignal
+    {
+        const char* name;
+        void (*generate)(AudioBuffer<float>&);
+    };
+
+    // Logarithmic 20 Hz to 20 kHz sweep, left at -6 dBFS and right at -18 dBFS
+    void generateSweep(AudioBuffer<float>& buffer)
+    {
+        const double k = std::log(20000.0 / 20.0);
+        const double duration = signalLength / GoldenReference::sampleRate;
+        for (int i = 0; i < signalLength; ++i)
+        {
+            const double t = i / GoldenReference::sampleRate;
+            const double phase = MathConstants<double>::twoPi * 20.0 * duration / k * (std::exp(t / duration * k) - 1.0);
+            buffer.setSample(0, i, 0.5f * static_cast<float>(std::sin(phase)));
+            buffer.setSample(1, i, 0.125f * static_cast<float>(std::sin(phase)));
+        }
+    }
+
+    // Impulses every 250 ms alternating between 0 and -12 dBFS, the right channel 100 samples late
+    void generateImpulses(AudioBuffer<float>& buffer)
+    {
+        buffer.clear();
+        const int spacing = static_cast<int>(GoldenReference::sampleRate / 4);
+        for (int i = 0, n = 0; i < signalLength; i += spacing, ++n)
+        {
+            const float amplitude = n % 2 == 0 ? 1.0f : 0.25f;
+            buffer.setSample(0, i, amplitude);
+            if (i + 100 < signalLength)
+                buffer.setSample(1, i + 100, -amplitude);
+        }
+    }
+
+    // White noise bursts, 100 ms on and 150 ms off, independent per channel
+    void generateNoiseBursts(AudioBuffer<float>& buffer)
+    {
+        Random random(0x61c8864);
+        const int period = static_cast<int>(GoldenReference::sampleRate / 4);
+        const int burst = static_cast<int>(GoldenReference::sampleRate / 10);
+        for (int i = 0; i < signalLength; ++i)
+            for (int ch = 0; ch < GoldenReference::numChannels; ++ch)
+                buffer.setSample(ch, i, i % period < burst ? 0.7f * (random.nextFloat() * 2.0f - 1.0f) : 0.0f);
+    }
+
+    // Constant levels held for 400 ms each, silence, -6, -26, 0 and -40 dBFS, the right channel inverted
+    void generateSteps(AudioBuffer<float>& buffer)
+    {
+        const float levels[] = {0.0f, 0.5f, 0.05f, 1.0f, 0.01f};
+        const int stepLength = signalLength / static_cast<int>(std::size(levels));
+        for (int i = 0; i < signalLength; ++i)
+        {
+            const float level = levels[jmin(i / stepLength, static_cast<int>(std::size(levels)) - 1)];
+            buffer.setSample(0, i, level);
+            buffer.setSample(1, i, -level);
+        }
+    }
+
+    const TestSignal testSignals[] = {
+        {"sweep", generateSweep},
+        {"impulses", generateImpulses},
+        {"noiseBursts", generateNoiseBursts},
+        {"steps", generateSteps},
+    };
+
+    struct ParameterSet
+    {
+        const char* name;
+        float threshold, ratio, knee, attack, release, makeup, mix;
+        Compressor::DetectionMode detectionMode;
+        bool automateHalfway; // Moves threshold and mix at half length so the parameter ramps are covered
+        LevelDetector::Topology topology{LevelDetector::Topology::branchedPeak};
+        int numBands{1};
+        float lookahead{0.0f};
+        int oversampling{1};         // Factor, linear phase
+        bool autoTimes{false};       // Auto attack and release
+        bool externalKey{false};     // Detects from the signal time-reversed with its channels swapped
+        float sidechainHighPass{0.0f};
+    };
+
+    // Blocks long enough for the multiband mode to split them on its worker threads
+    constexpr int parallelBlockSize = 2 * MultibandCompressor::minParallelBlockSize;
+
+    const ParameterSet parameterSets[] = {
+        {"hardKnee", -24.0f, 8.0f, 0.0f, 1.0f, 50.0f, 0.0f, 1.0f, Compressor::DetectionMode::maxLinked, false},
+        {"softKnee", -18.0f, 3.0f, 12.0f, 10.0f, 200.0f, 6.0f, 0.7f, Compressor::DetectionMode::rmsLinked, false},
+        {"unlinked", -30.0f, 20.0f, 6.0f, 0.1f, 20.0f, 3.0f, 1.0f, Compressor::DetectionMode::unlinked, false},
+        {"automation", -20.0f, 4.0f, 6.0f, 5.0f, 100.0f, 0.0f, 1.0f, Compressor::DetectionMode::maxLinked, true},
+        {"decoupled", -24.0f, 6.0f, 6.0f, 2.0f, 150.0f, 0.0f, 1.0f, Compressor::DetectionMode::maxLinked, false,
+         LevelDetector::Topology::decoupledPeak},
+        {"rms", -28.0f, 4.0f, 6.0f, 5.0f, 120.0f, 3.0f, 1.0f, Compressor::DetectionMode::maxLinked, false,
+         LevelDetector::Topology::rms},
+        {"hybrid", -22.0f, 6.0f, 0.0f, 1.0f, 80.0f, 0.0f, 0.8f, Compressor::DetectionMode::unlinked, false,
+         LevelDetector::Topology::hybrid},
+        {"multiband", -24.0f, 4.0f, 6.0f, 5.0f, 120.0f, 2.0f, 1.0f, Compressor::DetectionMode::maxLinked, false,
+         LevelDetector::Topology::branchedPeak, 4},
+        {"lookahead", -20.0f, 8.0f, 3.0f, 1.0f, 80.0f, 0.0f, 1.0f, Compressor::DetectionMode::maxLinked, false,
+         LevelDetector::Topology::branchedPeak, 1, 5.0f},
+        {"oversampling", -18.0f, 10.0f, 0.0f, 0.5f, 60.0f, 0.0f, 1.0f, Compressor::DetectionMode::maxLinked, false,
+         LevelDetector::Topology::branchedPeak, 1, 0.0f, 4},
+        {"autoTimes", -26.0f, 4.0f, 6.0f, 10.0f, 200.0f, 3.0f, 1.0f, Compressor::DetectionMode::maxLinked, false,
+         LevelDetector::Topology::branchedPeak, 1, 0.0f, 1, true},
+        {"externalKey", -24.0f, 6.0f, 6.0f, 2.0f, 100.0f, 0.0f, 1.0f, Compressor::DetectionMode::maxLinked, false,
+         LevelDetector::Topology::branchedPeak, 1, 0.0f, 1, false, true, 120.0f},
+    };
+
+    AudioBuffer<float> render(const TestSignal& signal, const ParameterSet& parameters, GoldenReference::Path path,
+                              int blockSize = GoldenReference::blockSize)
+    {
+        AudioBuffer<float> buffer(GoldenReference::numChannels, signalLength);
+        signal.generate(buffer);
+
+        AudioBuffer<float> key;
+        if (parameters.externalKey)
+        {
+            key.setSize(GoldenReference::numChannels, signalLength);
+            for (int ch = 0; ch < GoldenReference::numChannels; ++ch)
+                for (int i = 0; i < signalLength; ++i)
+                    key.setSample(GoldenReference::numChannels - 1 - ch, signalLength - 1 - i, buffer.getSample(ch, i));
+        }
+
+        // Parameters go in before prepare, so processing starts without ramps like in the plugin
+        Compressor compressor;
+        compressor.setThreshold(parameters.threshold);
+        compressor.setRatio(parameters.ratio);
+        compressor.setKnee(parameters.knee);
+        compressor.setAttack(parameters.attack);
+        compressor.setRelease(parameters.release);
+        compressor.setMakeup(parameters.makeup);
+        compressor.setMix(parameters.mix);
+        compressor.setDetectionMode(parameters.detectionMode);
+        compressor.setDetectorTopology(parameters.topology);
+        compressor.setNumBands(parameters.numBands);
+        compressor.setLookahead(parameters.lookahead);
+        compressor.setOversampling(parameters.oversampling, true);
+        compressor.setAutoAttack(parameters.autoTimes);
+        compressor.setAutoRelease(parameters.autoTimes);
+        compressor.setSidechainHighPass(parameters.sidechainHighPass);
+        compressor.setParallelBands(path == GoldenReference::Path::parallelBands);
+        compressor.setExactMode(path == GoldenReference::Path::reference || path == GoldenReference::Path::fusedExact);
+        compressor.setEngine(path == GoldenReference::Path::fused || path == GoldenReference::Path::fusedExact
+                                 ? Compressor::Engine::fused
+                                 : Compressor::Engine::multiPass);
+        compressor.prepare({GoldenReference::sampleRate, static_cast<uint32>(blockSize),
+                            static_cast<uint32>(GoldenReference::numChannels)});
+
+        for (int start = 0; start < signalLength; start += blockSize)
+        {
+            if (parameters.automateHalfway && start == signalLength / 2)
+            {
+                compressor.setThreshold(parameters.threshold - 15.0f);
+                compressor.setMix(parameters.mix * 0.5f);
+            }
+
+            const int numSamples = jmin(blockSize, signalLength - start);
+            AudioBuffer<float> block(buffer.getArrayOfWritePointers(), GoldenReference::numChannels, start, numSamples);
+            if (parameters.externalKey)
+                compressor.process(block, AudioBuffer<float>(key.getArrayOfWritePointers(),
+                                                             GoldenReference::numChannels, start, numSamples));
+            else
+                compressor.process(block);
+        }
+        return buffer;
+    }
+
+    String getReferenceName(const TestSignal& signal, const ParameterSet& parameters)
+    {
+        return String(signal.name) + "_" + parameters.name;
+    }
+}
+
+//==============================================================================
+String GoldenReference::getPathName(Path path)
+{
+    switch (path)
+    {
+        case Path::reference:  return "reference";
+        case Path::vector:     return "vector";
+        case Path::fused:      return "fused";
+        case Path::fusedExact: return "fusedExact";
+        case Path::parallelBands: return "parallelBands";
+    }
+    return {};
+}
+
+Result GoldenReference::writeReferences(const File& directory)
+{
+    if (!directory.createDirectory())
+        return Result::fail("Could not create " + directory.getFullPathName());
+
+    WavAudioFormat wavFormat;
+    for (const auto& signal : testSignals)
+    {
+        for (const auto& parameters : parameterSets)
+        {
+            const auto file = directory.getChildFile(getReferenceName(signal, parameters) + ".wav");
+            file.deleteFile();
+
+            auto stream = file.createOutputStream();
+            if (stream == nullptr)
+                return Result::fail("Could not open " + file.getFullPathName());
+
+            // 32 bit WAV is IEEE float, the references keep every bit of the render
+            std::unique_ptr<AudioFormatWriter> writer(
+                wavFormat.createWriterFor(stream.get(), sampleRate, numChannels, 32, {}, 0));
+            if (writer == nullptr)
+                return Result::fail("Could not create a writer for " + file.getFullPathName());
+            stream.release(); // Now owned by the writer
+
+            const auto buffer = render(signal, parameters, Path::reference);
+            if (!writer->writeFromAudioSampleBuffer(buffer, 0, buffer.getNumSamples()))
+                return Result::fail("Could not write " + file.getFullPathName());
+        }
+    }
+    return Result::ok();
+}
+
+std::vector<GoldenReference::Comparison> GoldenReference::verify(const File& directory, float maxErrorInDbfs)
+{
+    const float maxError = Decibels::decibelsToGain(maxErrorInDbfs, -1000.0f);
+    std::vector<Comparison> comparisons;
+    WavAudioFormat wavFormat;
+
+    for (const auto& signal : testSignals)
+    {
+        for (const auto& parameters : parameterSets)
+        {
+            const auto name = getReferenceName(signal, parameters);
+            AudioBuffer<float> reference(numChannels, signalLength);
+            bool referenceFound = false;
+
+            const auto file = directory.getChildFile(name + ".wav");
+            if (auto stream = file.createInputStream())
+            {
+                std::unique_ptr<AudioFormatReader> reader(wavFormat.createReaderFor(stream.release(), true));
+                referenceFound = reader != nullptr && reader->usesFloatingPointData
+                                 && static_cast<int>(reader->numChannels) == numChannels
+                                 && reader->lengthInSamples == signalLength
+                                 && reader->read(&reference, 0, signalLength, 0, true, true);
+            }
+
+            std::vector<Path> paths{Path::reference, Path::vector, Path::fused, Path::fusedExact};
+            if (parameters.numBands > 1)
+                paths.push_back(Path::parallelBands);
+
+            for (const auto path : paths)
+            {
+                Comparison comparison;
+                comparison.name = name + " " + getPathName(path);
+                comparison.path = path;
+
+                // The parallel bands must match the serial tree bit for bit, rendered in the same blocks
+                const bool parallel = path == Path::parallelBands;
+                comparison.referenceFound = parallel || referenceFound;
+
+                if (comparison.referenceFound)
+                {
+                    const auto output = render(signal, parameters, path, parallel ? parallelBlockSize : blockSize);
+                    const auto serial = parallel ? render(signal, parameters, Path::vector, parallelBlockSize)
+                                                 : AudioBuffer<float>();
+                    const auto& expectedOutput = parallel ? serial : reference;
+                    double sumOfSquares = 0.0;
+
+                    for (int ch = 0; ch < numChannels; ++ch)
+                    {
+                        const auto* actual = output.getReadPointer(ch);
+                        const auto* expected = expectedOutput.getReadPointer(ch);
+                        for (int i = 0; i < signalLength; ++i)
+                        {
+                            const float error = std::abs(actual[i] - expected[i]);
+                            sumOfSquares += static_cast<double>(error) * error;
+                            if (error > comparison.maxError)
+                            {
+                                comparison.maxError = error;
+                                comparison.maxErrorPosition = i;
+                            }
+                        }
+                    }
+
+                    comparison.rmsError = static_cast<float>(std::sqrt(sumOfSquares / (numChannels * signalLength)));
+                    comparison.passed = comparison.maxError <= (parallel ? 0.0f : maxError);
+                }
+                comparisons.push_back(comparison);
+            }
+        }
+    }
+    return comparisons;
+}
+
+int GoldenReference::printReport(const std::vector<Comparison>& comparisons, std::ostream& stream)
+{
+    auto toDbfs = [](float error) { return Decibels::gainToDecibels(error, -300.0f); };
+    int numFailed = 0;
+
+    stream << std::fixed << std::setprecision(1);
+    for (const auto& comparison : comparisons)
+    {
+        numFailed += comparison.passed ? 0 : 1;
+        stream << (comparison.passed ? "pass  " : "FAIL  ") << std::left << std::setw(36) << comparison.name << std::right;
+
+        if (!comparison.referenceFound)
+            stream << "  no reference\n";
+        else if (comparison.maxError == 0.0f)
+            stream << "  bit-identical\n";
+        else
+            stream << "  max " << std::setw(7) << toDbfs(comparison.maxError) << " dBFS at " << std::setw(6)
+                   << comparison.maxErrorPosition << "  rms " << std::setw(7) << toDbfs(comparison.rmsError) << " dBFS\n";
+    }
+
+    stream << comparisons.size() - static_cast<size_t>(numFailed) << " of " << comparisons.size() << " path(s) passed\n";
+    return numFailed;
+}
@@ -0,0 +1,79 @@
+/*
+  ==============================================================================
+    File:           DspBenchmark.h
+    Developers:     D. Robert Hoover and Kris Keillor
+    Repository URL: https://github.com/Top-Notch-DSP/GlobeLoveler
+    Date:           2024 Feb 1
+    License:        GNU General Public License, version 3.0 (GPL-3.0)
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <ostream>
+
+/* DspBenchmark:
+ * Times every DSP stage of the compressor across block sizes, sample rates and channel counts.
+ * Stages that work in place get their input restored before every call, the cost of the
+ * restore is measured separately and subtracted. Results are ns and cycles per sample
+ * (per sample and channel for multi-channel stages) and round-trip through JSON for baselines.
+ */
+class DspBenchmark
+{
+public:
+    struct Settings
+    {
+        std::vector<int> blockSizes{16, 32, 64, 128, 256, 512, 1024, 2048, 4096, 8192};
+        std::vector<double> sampleRates{44100.0, 48000.0, 96000.0, 192000.0};
+        std::vector<int> channelCounts{1, 2, 6};
+        double secondsPerMeasurement{0.01};
+        int numMeasurements{5};     // The median is reported
+        String filter;              // Only stages containing this text, all when empty
+    };
+
+    struct Measurement
+    {
+        String stage;
+        int blockSize{0};
+        double sampleRate{0.0};
+        int numChannels{1};
+        double nsPerSample{0.0};
+        double cyclesPerSample{-1.0};   // Time stamp counter cycles, -1 where there is none
+
+        // Identifies the case across runs
+        String getKey() const;
+    };
+
+    explicit DspBenchmark(const Settings&);
+
+    // Runs every stage, onMeasurement is called as results come in
+    std::vector<Measurement> run(const std::function<void(const Measurement&)>& onMeasurement = {});
+
+    static var toJson(const std::vector<Measurement>&);
+    static std::vector<Measurement> fromJson(const var&);
+
+    // Prints every case slower than the baseline by more than tolerancePercent, returns how many there were
+    static int compare(const std::vector<Measurement>& current, const std::vector<Measurement>& baseline,
+                       double tolerancePercent, std::ostream& stream);
+
+    // Returns true if a time stamp counter backs cyclesPerSample on this machine
+    static bool hasCycleCounter();
+
+private:
+    template <typename Restore, typename Body>
+    Measurement measure(const String& stage, int blockSize, double sampleRate, int numChannels,
+                        Restore&& restore, Body&& body) const;
+
+    bool isSelected(const String& stage) const;
+
+    void benchmarkGainComputer(std::vector<Measurement>&, const std::function<void(const Measurement&)>&);
+    void benchmarkLevelDetector(std::vector<Measurement>&, const std::function<void(const Measurement&)>&);
+    void benchmarkEnvelopeFollower(std::vector<Measurement>&, const std::function<void(const Measurement&)>&);
+    void benchmarkSidechainFilter(std::vector<Measurement>&, const std::function<void(const Measurement&)>&);
+    void benchmarkCompressor(std::vector<Measurement>&, const std::function<void(const Measurement&)>&);
+
+    Settings settings;
+
+    JUCE_DECLARE_NON_COPYABLE(DspBenchmark)
+};
@@ -0,0 +1,64 @@
+/*
+  ==============================================================================
+    File:           GoldenReference.h
+    Developers:     D. Robert Hoover and Kris Keillor
+    Repository URL: https://github.com/Top-Notch-DSP/GlobeLoveler
+    Date:           2024 Feb 1
+    License:        GNU General Public License, version 3.0 (GPL-3.0)
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <ostream>
+
+/* GoldenReference:
+ * Numerical regression check for the compressor. A bank of procedural test signals (sine sweep,
+ * impulses, noise bursts, level steps) is rendered through the exact scalar path and stored as
+ * 32 bit float WAV files. Every processing path is later rendered again and compared to them
+ * sample by sample, reporting the maximum and RMS error.
+ * The parameter sets cover every detector topology, multiband, lookahead, oversampling, auto attack and release
+ * and an external key through the side-chain filter.
+ */
+class GoldenReference
+{
+public:
+    // Processing paths that are rendered and compared
+    enum class Path
+    {
+        reference,    // Multi-pass engine with the exact scalar kernels, what the references are made of
+        vector,       // Multi-pass engine with the SIMD kernels
+        fused,        // Fused engine with the SIMD kernels
+        fusedExact,   // Fused engine with the exact scalar kernels
+        parallelBands // Multiband sets only, bands on worker threads in blocks long enough to be split.
+                      // Compared bit for bit to the serial multi-pass render in the same blocks
+    };
+
+    struct Comparison
+    {
+        String name;                // Signal, parameter set and path
+        Path path{Path::reference};
+        bool referenceFound{false};
+        float maxError{0.0f};       // Largest absolute sample difference
+        float rmsError{0.0f};
+        int64 maxErrorPosition{0};  // Sample of the largest difference
+        bool passed{false};
+    };
+
+    static constexpr double sampleRate = 48000.0;
+    static constexpr int numChannels = 2;
+    static constexpr int blockSize = 512;
+
+    // Renders every signal and parameter set through Path::reference into directory
+    static Result writeReferences(const File& directory);
+
+    // Renders every path and compares it to the references in directory.
+    // A path passes when no sample differs by more than maxErrorInDbfs
+    static std::vector<Comparison> verify(const File& directory, float maxErrorInDbfs);
+
+    // Prints one line per comparison and a summary, returns the number of failures
+    static int printReport(const std::vector<Comparison>&, std::ostream& stream);
+
+    static String getPathName(Path);
+};
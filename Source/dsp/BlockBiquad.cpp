@@ -0,0 +1,143 @@
+/*
+  ==============================================================================
+    File:           BlockBiquad.cpp
+    Developers:     D. Robert Hoover and Kris Keillor
+    Repository URL: https://github.com/Top-Notch-DSP/GlobeLoveler
+    Date:           2024 Feb 1
+    License:        GNU General Public License, version 3.0 (GPL-3.0)
+  ==============================================================================
+*/
+
+#include "include/BlockBiquad.h"
+
+namespace
+{
+    struct Prototype
+    {
+        double cosW0, alpha;
+    };
+
+    Prototype prototype(double sampleRate, double frequency, double q)
+    {
+        const double w0 = MathConstants<double>::twoPi * jmin(frequency, 0.49 * sampleRate) / sampleRate;
+        return {std::cos(w0), std::sin(w0) / (2.0 * q)};
+    }
+}
+
+BlockBiquad::Coefficients BlockBiquad::make(double b0, double b1, double b2, double a0, double a1, double a2)
+{
+    Coefficients c;
+    c.b0 = static_cast<float>(b0 / a0);
+    c.b1 = static_cast<float>(b1 / a0);
+    c.b2 = static_cast<float>(b2 / a0);
+    c.a1 = static_cast<float>(a1 / a0);
+    c.a2 = static_cast<float>(a2 / a0);
+
+    // h[k] = -a1 h[k-1] - a2 h[k-2], the same recursion gives the response to y[-1] and y[-2]
+    double h[groupSize];
+    double fromY1[groupSize + 2] = {0.0, 1.0};
+    double fromY2[groupSize + 2] = {1.0, 0.0};
+
+    for (int k = 0; k < groupSize; ++k)
+    {
+        h[k] = k == 0 ? 1.0 : -c.a1 * h[k - 1] - (k >= 2 ? c.a2 * h[k - 2] : 0.0);
+        fromY1[k + 2] = -c.a1 * fromY1[k + 1] - c.a2 * fromY1[k];
+        fromY2[k + 2] = -c.a1 * fromY2[k + 1] - c.a2 * fromY2[k];
+        c.fromY1[k] = static_cast<float>(fromY1[k + 2]);
+        c.fromY2[k] = static_cast<float>(fromY2[k + 2]);
+    }
+
+    for (int j = 0; j < groupSize; ++j)
+        for (int i = 0; i < blockSize; ++i)
+            c.impulse[j][i] = i % groupSize >= j ? static_cast<float>(h[j]) : 0.0f;
+
+    return c;
+}
+
+BlockBiquad::Coefficients BlockBiquad::lowPass(double sampleRate, double frequency, double q)
+{
+    const auto p = prototype(sampleRate, frequency, q);
+    return make((1.0 - p.cosW0) * 0.5, 1.0 - p.cosW0, (1.0 - p.cosW0) * 0.5,
+                1.0 + p.alpha, -2.0 * p.cosW0, 1.0 - p.alpha);
+}
+
+BlockBiquad::Coefficients BlockBiquad::highPass(double sampleRate, double frequency, double q)
+{
+    const auto p = prototype(sampleRate, frequency, q);
+    return make((1.0 + p.cosW0) * 0.5, -(1.0 + p.cosW0), (1.0 + p.cosW0) * 0.5,
+                1.0 + p.alpha, -2.0 * p.cosW0, 1.0 - p.alpha);
+}
+
+BlockBiquad::Coefficients BlockBiquad::allPass(double sampleRate, double frequency, double q)
+{
+    const auto p = prototype(sampleRate, frequency, q);
+    return make(1.0 - p.alpha, -2.0 * p.cosW0, 1.0 + p.alpha,
+                1.0 + p.alpha, -2.0 * p.cosW0, 1.0 - p.alpha);
+}
+
+void BlockBiquad::process(const Coefficients& c, State& state, float* data, int numSamples)
+{
+    for (int start = 0; start < numSamples; start += blockSize)
+        processBlock(c, state, data + start, jmin(blockSize, numSamples - start));
+}
+
+void BlockBiquad::processBlock(const Coefficients& c, State& state, float* data, int numSamples)
+{
+    jassert(numSamples <= blockSize);
+
+    // Input with two samples of history in front, so every feed-forward tap is one vector operation
+    alignas(32) float input[blockSize + 2];
+    // Feed-forward output behind groupSize - 1 zeros, the impulse taps reach back that far
+    alignas(32) float feedForward[blockSize + groupSize - 1];
+    alignas(32) float zeroState[blockSize];
+    float* const w = feedForward + groupSize - 1;
+    FloatVectorOperations::clear(feedForward, groupSize - 1);
+
+    input[0] = state.x2;
+    input[1] = state.x1;
+    FloatVectorOperations::copy(input + 2, data, numSamples);
+
+    FloatVectorOperations::copyWithMultiply(w, input + 2, c.b0, numSamples);
+    FloatVectorOperations::addWithMultiply(w, input + 1, c.b1, numSamples);
+    FloatVectorOperations::addWithMultiply(w, input, c.b2, numSamples);
+
+    state.x2 = input[numSamples];
+    state.x1 = input[numSamples + 1];
+
+    // Zero-state response of every group: lane k sums h[j] * w[n + k - j] for j <= k
+    FloatVectorOperations::copy(zeroState, w, numSamples);
+    for (int j = 1; j < groupSize; ++j)
+        FloatVectorOperations::addWithMultiply(zeroState, w - j, c.impulse[j], numSamples);
+
+    // Only the state crosses group boundaries, the four lanes of a group are independent
+    float y1 = state.y1;
+    float y2 = state.y2;
+    int i = 0;
+    for (; i + groupSize <= numSamples; i += groupSize)
+    {
+        // Kept in registers, reading the state back from data would put a store on the serial path
+        const float y0 = zeroState[i] + c.fromY1[0] * y1 + c.fromY2[0] * y2;
+        const float yA = zeroState[i + 1] + c.fromY1[1] * y1 + c.fromY2[1] * y2;
+        const float yB = zeroState[i + 2] + c.fromY1[2] * y1 + c.fromY2[2] * y2;
+        const float yC = zeroState[i + 3] + c.fromY1[3] * y1 + c.fromY2[3] * y2;
+
+        data[i] = y0;
+        data[i + 1] = yA;
+        data[i + 2] = yB;
+        data[i + 3] = yC;
+        y1 = yC;
+        y2 = yB;
+    }
+
+    // Samples short of a whole group run the plain recursion
+    for (; i < numSamples; ++i)
+    {
+        const float y = w[i] - c.a1 * y1 - c.a2 * y2;
+        y2 = y1;
+        y1 = y;
+        data[i] = y;
+    }
+
+    state.y1 = y1;
+    state.y2 = y2;
+}
@@ -0,0 +1,33 @@
+/*
+  ==============================================================================
+    File:           CoefficientTable.cpp
+    Developers:     D. Robert Hoover and Kris Keillor
+    Repository URL: https://github.com/Top-Notch-DSP/GlobeLoveler
+    Date:           2024 Feb 1
+    License:        GNU General Public License, version 3.0 (GPL-3.0)
+  ==============================================================================
+*/
+
+#include "include/CoefficientTable.h"
+
+CoefficientTable::CoefficientTable()
+{
+    values[0] = 1.0;
+    for (int i = 1; i <= size; ++i)
+    {
+        const double x = static_cast<double>(i) / size;
+        values[i] = -std::expm1(-x) / x;
+    }
+    values[size + 1] = values[size];
+}
+
+const CoefficientTable& CoefficientTable::getInstance()
+{
+    static const CoefficientTable table;
+    return table;
+}
+
+double CoefficientTable::getCoefficient(double timeInSeconds, double sampleRate) const
+{
+    return getDecay(1.0 / (timeInSeconds * sampleRate));
+}
@@ -25,11 +25,103 @@ Compressor::~Compressor()
 void Compressor::prepare(const juce::dsp::ProcessSpec& ps)
 {
     procSpec = ps;
-    ballistics.prepare(ps.sampleRate);
-    originalSignal.setSize(2, ps.maximumBlockSize);
-    sidechainSignal.resize(ps.maximumBlockSize, 0.0f);
+    const auto numChannels = static_cast<int>(jmax(ps.numChannels, 1u));
+
+    // One detector and side-chain per channel covers every detection mode
+    ballistics.resize(numChannels);
+    for (auto& detector : ballistics)
+    {
+        detector.setAttack(attackTimeInSeconds);
+        detector.setRelease(releaseTimeInSeconds);
+        detector.setAutoAttack(autoAttack);
+        detector.setAutoRelease(autoRelease);
+        detector.setTopology(detectorTopology);
+        detector.setMaximumSampleRate(ps.sampleRate * maxOversamplingFactor);
+        detector.setMaximumBlockSize(jmax(static_cast<int>(ps.maximumBlockSize) * maxOversamplingFactor,
+                                          fusedBlockSize));
+    }
+
+    // Every oversampling variant up front, so switching on the audio thread never allocates
+    // Channels beyond numChannels carry an external key through the same filters
+    for (int phase = 0; phase < 2; ++phase)
+    {
+        for (int stages = 1; stages <= 3; ++stages)
+        {
+            auto& variant = oversamplers[phase][stages - 1];
+            variant = std::make_unique<dsp::Oversampling<float>>(
+                static_cast<size_t>(2 * numChannels), static_cast<size_t>(stages),
+                phase == 1 ? dsp::Oversampling<float>::filterHalfBandFIREquiripple
+                           : dsp::Oversampling<float>::filterHalfBandPolyphaseIIR,
+                true, true);
+            variant->initProcessing(ps.maximumBlockSize);
+        }
+    }
+    upsamplingInput.assign(2 * numChannels, nullptr);
+    oversampledChannels.assign(2 * numChannels, nullptr);
+
+    VectorKernels::getInstructionSetName(); // Resolve kernel dispatch before the first audio callback
+    sidechainStride = static_cast<int>(ps.maximumBlockSize) * maxOversamplingFactor;
+    sidechainSignal.assign(numChannels * sidechainStride, 0.0f);
     rawSidechainSignal = sidechainSignal.data();
-    originalSignal.clear();
+    fusedSidechainSignal.assign(numChannels * fusedBlockSize, 0.0f);
+
+    // Filtered copy of every detection source, the input channels or an external key
+    sidechainFilter.prepare(ps.sampleRate, numChannels);
+    filteredKeySignal.assign(numChannels * sidechainStride, 0.0f);
+    filteredKeyChannels.resize(numChannels);
+    for (int ch = 0; ch < numChannels; ++ch)
+        filteredKeyChannels[ch] = filteredKeySignal.data() + ch * sidechainStride;
+
+    // Room for the longest lookahead at the highest rate, so changing either later never allocates
+    const auto maxLookaheadSamples = static_cast<int>(std::ceil(maxLookaheadInMs * 0.001 * ps.sampleRate))
+                                     * maxOversamplingFactor;
+    lookaheadDelay.prepare(numChannels, maxLookaheadSamples);
+    multiband.setMaximumSampleRate(ps.sampleRate * maxOversamplingFactor);
+    multiband.prepare(ps.sampleRate, numChannels, sidechainStride, maxLookaheadSamples);
+
+    channelGroup.assign(numChannels, 0);
+    groupId.assign(numChannels, 0);
+    groupSize.assign(numChannels, 0);
+    groupFirstChannel.assign(numChannels, 0);
+    updateGroups(numChannels);
+
+    prepareProcessingRate();
+}
+
+void Compressor::prepareProcessingRate()
+{
+    // Detection, gain and parameter ramps all run at the oversampled rate
+    const auto rate = getProcessingRate();
+
+    oversampler = nullptr;
+    if (oversamplingFactor > 1)
+    {
+        const int stages = oversamplingFactor == 2 ? 1 : (oversamplingFactor == 4 ? 2 : 3);
+        oversampler = oversamplers[linearPhaseOversampling ? 1 : 0][stages - 1].get();
+        oversampler->reset();
+    }
+
+    for (auto& detector : ballistics)
+        detector.prepare(rate);
+    sidechainFilter.setSampleRate(rate);
+    multiband.setSampleRate(rate);
+
+    lookaheadDelay.setDelay(getLookaheadSamples() * oversamplingFactor);
+    lookaheadDelay.reset();
+    multiband.setLookahead(lookaheadDelay.getDelay());
+
+    resetSmoothers();
+}
+
+double Compressor::getProcessingRate() const
+{
+    return procSpec.sampleRate * oversamplingFactor;
+}
+
+int Compressor::getLookaheadSamples() const
+{
+    // Whole samples at the base rate, so the latency stays an integer at every oversampling factor
+    return roundToInt(lookaheadInMs * 0.001 * procSpec.sampleRate);
 }
 
 void Compressor::setPower(bool newPower)
@@ -44,42 +136,194 @@ void Compressor::setInput(float newInput)
 
 void Compressor::setAttack(float attackTimeInMs)
 {
-    ballistics.setAttack(attackTimeInMs * 0.001);
+    attackTimeInSeconds = attackTimeInMs * 0.001;
+    for (auto& detector : ballistics)
+        detector.setAttack(attackTimeInSeconds);
+    for (int band = 0; band < MultibandCompressor::maxBands; ++band)
+        multiband.setAttack(band, attackTimeInMs);
 }
 
 void Compressor::setRelease(float releaseTimeInMs)
 {
-    ballistics.setRelease(releaseTimeInMs * 0.001);
+    releaseTimeInSeconds = releaseTimeInMs * 0.001;
+    for (auto& detector : ballistics)
+        detector.setRelease(releaseTimeInSeconds);
+    for (int band = 0; band < MultibandCompressor::maxBands; ++band)
+        multiband.setRelease(band, releaseTimeInMs);
+}
+
+void Compressor::setAutoAttack(bool shouldBeAutomatic)
+{
+    autoAttack = shouldBeAutomatic;
+    for (auto& detector : ballistics)
+        detector.setAutoAttack(shouldBeAutomatic);
+    for (int band = 0; band < MultibandCompressor::maxBands; ++band)
+        multiband.setAutoAttack(band, shouldBeAutomatic);
+}
+
+void Compressor::setAutoRelease(bool shouldBeAutomatic)
+{
+    autoRelease = shouldBeAutomatic;
+    for (auto& detector : ballistics)
+        detector.setAutoRelease(shouldBeAutomatic);
+    for (int band = 0; band < MultibandCompressor::maxBands; ++band)
+        multiband.setAutoRelease(band, shouldBeAutomatic);
+}
+
+void Compressor::setDetectorTopology(LevelDetector::Topology newTopology)
+{
+    detectorTopology = newTopology;
+    for (auto& detector : ballistics)
+        detector.setTopology(newTopology);
+    for (int band = 0; band < MultibandCompressor::maxBands; ++band)
+        multiband.setTopology(band, newTopology);
 }
 
 void Compressor::setRatio(float rat)
 {
-    gainComputer.setRatio(rat);
+    ratioSmoother.setTargetValue(rat);
+    if (!ratioSmoother.isSmoothing())
+        gainComputer.setRatio(rat);
+    for (int band = 0; band < MultibandCompressor::maxBands; ++band)
+        multiband.setRatio(band, rat);
 }
 
 void Compressor::setKnee(float kneeInDb)
 {
-    gainComputer.setKnee(kneeInDb);
+    kneeSmoother.setTargetValue(kneeInDb);
+    if (!kneeSmoother.isSmoothing())
+        gainComputer.setKnee(kneeInDb);
+    for (int band = 0; band < MultibandCompressor::maxBands; ++band)
+        multiband.setKnee(band, kneeInDb);
 }
 
 void Compressor::setThreshold(float thresholdInDb)
 {
-    gainComputer.setThreshold(thresholdInDb);
+    thresholdSmoother.setTargetValue(thresholdInDb);
+    if (!thresholdSmoother.isSmoothing())
+        gainComputer.setThreshold(thresholdInDb);
+    for (int band = 0; band < MultibandCompressor::maxBands; ++band)
+        multiband.setThreshold(band, thresholdInDb);
 }
 
 void Compressor::setMakeup(float makeupGainInDb)
 {
-    makeup = makeupGainInDb;
+    makeupSmoother.setTargetValue(makeupGainInDb);
+    if (!makeupSmoother.isSmoothing())
+        makeup = makeupGainInDb;
+    for (int band = 0; band < MultibandCompressor::maxBands; ++band)
+        multiband.setMakeup(band, makeupGainInDb);
 }
 
 void Compressor::setMix(float newMix)
 {
-    mix = newMix;
+    mixSmoother.setTargetValue(newMix);
+    if (!mixSmoother.isSmoothing())
+        mix = newMix;
+    multiband.setMix(newMix);
+}
+
+void Compressor::setLookahead(float lookaheadTimeInMs)
+{
+    lookaheadInMs = jlimit(0.0f, maxLookaheadInMs, lookaheadTimeInMs);
+    lookaheadDelay.setDelay(getLookaheadSamples() * oversamplingFactor);
+    multiband.setLookahead(lookaheadDelay.getDelay());
+}
+
+void Compressor::setSidechainHighPass(float frequencyInHz)
+{
+    sidechainFilter.setHighPass(frequencyInHz);
+}
+
+void Compressor::setSidechainTilt(float tiltInDecibels)
+{
+    sidechainFilter.setTilt(tiltInDecibels);
+}
+
+void Compressor::setNumBands(int newNumBands)
+{
+    const int bands = newNumBands > 1
+                          ? jlimit(MultibandCompressor::minBands, MultibandCompressor::maxBands, newNumBands)
+                          : 1;
+    if (bands == numBands)
+        return;
+
+    // Neither path kept its state up to date while the other one ran
+    numBands = bands;
+    if (numBands > 1)
+        multiband.setNumBands(numBands);
+    multiband.reset();
+    lookaheadDelay.reset();
+
+    // Back to single-band: detectors, side-chain filter and ramps still hold what they had before the split
+    if (numBands == 1)
+    {
+        const auto rate = getProcessingRate();
+        for (auto& detector : ballistics)
+            detector.prepare(rate);
+        sidechainFilter.reset();
+        resetSmoothers();
+    }
+}
+
+void Compressor::setCrossovers(float lowInHz, float highInHz)
+{
+    multiband.setCrossovers(lowInHz, highInHz);
+}
+
+void Compressor::setParallelBands(bool shouldBeParallel)
+{
+    multiband.setParallelProcessing(shouldBeParallel);
+}
+
+void Compressor::setOversampling(int factor, bool linearPhase)
+{
+    const int newFactor = factor >= 8 ? 8 : (factor >= 4 ? 4 : (factor >= 2 ? 2 : 1));
+    if (newFactor == oversamplingFactor && linearPhase == linearPhaseOversampling)
+        return;
+
+    oversamplingFactor = newFactor;
+    linearPhaseOversampling = linearPhase;
+    if (procSpec.sampleRate > 0.0)
+        prepareProcessingRate();
+}
+
+void Compressor::setSmoothingTime(float timeInMs)
+{
+    smoothingTimeInSeconds = timeInMs * 0.001;
+    if (procSpec.sampleRate > 0.0)
+        resetSmoothers();
+}
+
+void Compressor::setExactMode(bool newExactMode)
+{
+    exactMode = newExactMode;
+    multiband.setExactMode(newExactMode);
+}
+
+void Compressor::setEngine(Engine newEngine)
+{
+    engine = newEngine;
+}
+
+void Compressor::setDetectionMode(DetectionMode newMode)
+{
+    if (newMode != detectionMode)
+    {
+        detectionMode = newMode;
+        updateGroups(numGroupedChannels);
+    }
+}
+
+void Compressor::setChannelGroups(const std::vector<int>& groups)
+{
+    customGroups = groups;
+    updateGroups(numGroupedChannels);
 }
 
 float Compressor::getMakeup()
 {
-    return makeup;
+    return makeupSmoother.getTargetValue();
 }
 
 double Compressor::getSampleRate()
@@ -93,55 +337,515 @@ float Compressor::getMaxGainReduction()
     return maxGainReduction;
 }
 
+int Compressor::getLatencySamples() const
+{
+    // The filters are set up for integer latency
+    const int filterLatency = oversampler != nullptr ? roundToInt(oversampler->getLatencyInSamples()) : 0;
+    return lookaheadDelay.getDelay() / oversamplingFactor + filterLatency;
+}
+
+int64 Compressor::getSettlingSamples(float maxErrorInDecibels, float maxAttenuationInDecibels) const
+{
+    jassert(maxErrorInDecibels > 0.0f && procSpec.sampleRate > 0.0 && ! ballistics.empty());
+
+    // alpha^n * maxAttenuation < maxError with alpha = e^(-1/(T*fs))  =>  n > T*fs*ln(maxAttenuation/maxError)
+    // The channels' detectors share one setting, the bands of the multiband mode can each have their own
+    const auto decay = std::log(jmax(1.0, static_cast<double>(maxAttenuationInDecibels) / maxErrorInDecibels));
+    const auto settlingTime = numBands > 1 ? multiband.getSettlingTime(decay) : ballistics.front().getSettlingTime(decay);
+    return static_cast<int64>(std::ceil(settlingTime * procSpec.sampleRate));
+}
+
 void Compressor::process(AudioBuffer<float>& buffer)
+{
+    processWithKey(buffer, nullptr, 0);
+}
+
+void Compressor::process(AudioBuffer<float>& buffer, const AudioBuffer<float>& sidechainInput)
+{
+    jassert(sidechainInput.getNumSamples() >= buffer.getNumSamples());
+
+    const auto numKey = jmin(sidechainInput.getNumChannels(), static_cast<int>(channelGroup.size()));
+    processWithKey(buffer, numKey > 0 ? sidechainInput.getArrayOfReadPointers() : nullptr, numKey);
+}
+
+void Compressor::processWithKey(AudioBuffer<float>& buffer, const float* const* key, int numKey)
+{
+    jassert(buffer.getNumChannels() <= static_cast<int>(channelGroup.size()));
+    jassert(buffer.getNumSamples() <= static_cast<int>(procSpec.maximumBlockSize));
+
+    if (oversampler == nullptr)
+    {
+        keyChannels = key;
+        numKeyChannels = numKey;
+        processAtProcessingRate(buffer);
+        keyChannels = nullptr;
+        return;
+    }
+
+    // Up, compress at the higher rate, and back down into buffer. The key rides along behind the input
+    const auto numChannels = jmin(buffer.getNumChannels(), static_cast<int>(channelGroup.size()));
+    const auto numSamples = static_cast<size_t>(buffer.getNumSamples());
+
+    for (int ch = 0; ch < numChannels; ++ch)
+        upsamplingInput[ch] = buffer.getReadPointer(ch);
+    for (int ch = 0; ch < numKey; ++ch)
+        upsamplingInput[numChannels + ch] = key[ch];
+
+    dsp::AudioBlock<const float> upsamplingBlock(upsamplingInput.data(), static_cast<size_t>(numChannels + numKey),
+                                                 numSamples);
+    auto oversampledBlock = oversampler->processSamplesUp(upsamplingBlock);
+
+    for (int ch = 0; ch < numChannels + numKey; ++ch)
+        oversampledChannels[ch] = oversampledBlock.getChannelPointer(static_cast<size_t>(ch));
+
+    AudioBuffer<float> oversampledBuffer(oversampledChannels.data(), numChannels,
+                                         static_cast<int>(oversampledBlock.getNumSamples()));
+    keyChannels = numKey > 0 ? oversampledChannels.data() + numChannels : nullptr;
+    numKeyChannels = numKey;
+    processAtProcessingRate(oversampledBuffer);
+    keyChannels = nullptr;
+
+    // Only the input channels come back down
+    dsp::AudioBlock<float> block(buffer.getArrayOfWritePointers(), static_cast<size_t>(numChannels), numSamples);
+    oversampler->processSamplesDown(block);
+}
+
+void Compressor::processAtProcessingRate(AudioBuffer<float>& buffer)
 {
     if (!bypassed)
     {
-        const auto numSamples = buffer.getNumSamples();
-        const auto numChannels = buffer.getNumChannels();
+        // Groups span the channels of this call, a mono view of a stereo-prepared compressor links one channel
+        const auto numChannels = jmin(buffer.getNumChannels(), static_cast<int>(channelGroup.size()));
+        if (numChannels != numGroupedChannels)
+            updateGroups(numChannels);
 
-        jassert(numSamples == static_cast<int>(sidechainSignal.size()));
+        // Parameter ramps are applied per sample, which only the fused engine does.
+        // The bands take every parameter change straight away
+        if (numBands > 1)
+            processMultiband(buffer);
+        else if (engine == Engine::fused || isSmoothing())
+            processFused(buffer);
+        else
+            processMultiPass(buffer);
+    }
+    else
+    {
+        // Keep the latency while bypassed so the host's compensation stays valid
+        lookaheadDelay.process(buffer.getArrayOfWritePointers(),
+                               jmin(buffer.getNumChannels(), static_cast<int>(channelGroup.size())), 0,
+                               buffer.getNumSamples());
+    }
+}
 
-        // Clear any old samples
-        originalSignal.clear();
-        FloatVectorOperations::fill(rawSidechainSignal, 0.0f, numSamples);
-        maxGainReduction = 0.0f;
+void Compressor::processMultiPass(AudioBuffer<float>& buffer)
+{
+    const auto numSamples = buffer.getNumSamples();
+    const auto numChannels = jmin(buffer.getNumChannels(), static_cast<int>(channelGroup.size()));
+
+    // Apply input gain
+    applyInputGain(buffer, numSamples);
+
+    const auto processor = selectRangeProcessor(numChannels);
+    maxGainReduction = (this->*processor)(buffer.getArrayOfWritePointers(), numChannels, 0, numSamples,
+                                          rawSidechainSignal, sidechainStride);
+}
+
+void Compressor::processMultiband(AudioBuffer<float>& buffer)
+{
+    const auto numSamples = buffer.getNumSamples();
+    const auto numChannels = jmin(buffer.getNumChannels(), static_cast<int>(channelGroup.size()));
+
+    // Apply input gain
+    applyInputGain(buffer, numSamples);
+
+    maxGainReduction = multiband.process(buffer.getArrayOfWritePointers(), numChannels, numSamples);
+}
+
+void Compressor::processFused(AudioBuffer<float>& buffer)
+{
+    const auto numSamples = buffer.getNumSamples();
+    const auto numChannels = jmin(buffer.getNumChannels(), static_cast<int>(channelGroup.size()));
+    float* const* channels = buffer.getArrayOfWritePointers();
+
+    // Same gain sequence as AudioBuffer::applyGain/applyGainRamp over the whole block
+    const float startGain = Decibels::decibelsToGain(prevInput);
+    const float endGain = Decibels::decibelsToGain(input);
+    const float gainIncrement = prevInput == input ? 0.0f : (endGain - startGain) / static_cast<float>(numSamples);
+    float inputGain = startGain;
+    prevInput = input;
+
+    float minGainReduction = 0.0f;
+
+    for (int start = 0; start < numSamples; start += fusedBlockSize)
+    {
+        const int n = jmin(fusedBlockSize, numSamples - start);
 
         // Apply input gain
-        applyInputGain(buffer, numSamples);
+        if (gainIncrement == 0.0f)
+        {
+            for (int ch = 0; ch < numChannels; ++ch)
+                FloatVectorOperations::multiply(channels[ch] + start, inputGain, n);
+        }
+        else
+        {
+            float nextGain = inputGain;
+            for (int ch = 0; ch < numChannels; ++ch)
+            {
+                float* data = channels[ch] + start;
+                float gain = inputGain;
+                for (int i = 0; i < n; ++i)
+                {
+                    data[i] *= gain;
+                    gain += gainIncrement;
+                }
+                nextGain = gain;
+            }
+            inputGain = nextGain;
+        }
+
+        // The ramps may end within the block, so the core is picked per sub-block
+        const auto processor = selectRangeProcessor(numChannels);
+        const float reduction = (this->*processor)(channels, numChannels, start, n,
+                                                   fusedSidechainSignal.data(), fusedBlockSize);
+        minGainReduction = jmin(minGainReduction, reduction);
+    }
+
+    maxGainReduction = minGainReduction;
+}
+
+const float* const* Compressor::getDetectionSource(float* const* channels, int numChannels, int start,
+                                                   int numSamples, int& numSources, int& sourceStart)
+{
+    // Detection source: the input itself or the external key, through the side-chain filter when it's on
+    const float* const* source = keyChannels != nullptr ? keyChannels : channels;
+    numSources = keyChannels != nullptr ? numKeyChannels : numChannels;
+    sourceStart = start;
+
+    if (sidechainFilter.isActive())
+    {
+        for (int ch = 0; ch < numSources; ++ch)
+        {
+            FloatVectorOperations::copy(filteredKeyChannels[ch], source[ch] + start, numSamples);
+            sidechainFilter.process(ch, filteredKeyChannels[ch], numSamples);
+        }
+        source = filteredKeyChannels.data();
+        sourceStart = 0;
+    }
+
+    return source;
+}
+
+Compressor::RangeProcessor Compressor::selectRangeProcessor(int numChannels) const
+{
+    // Ramps, the exact reference paths and every grouping but one peak-linked group take the generic path
+    if (exactMode || isSmoothing() || numGroups != 1 || detectionMode == DetectionMode::rmsLinked
+        || numChannels < 1 || numChannels > 2)
+        return &Compressor::processRange;
+
+    const bool hardKnee = gainComputer.isHardKnee();
+    switch (detectorTopology)
+    {
+    case LevelDetector::Topology::branchedPeak:
+        return hardKnee ? selectRangeCore<true, LevelDetector::Topology::branchedPeak>(numChannels)
+                        : selectRangeCore<false, LevelDetector::Topology::branchedPeak>(numChannels);
+    case LevelDetector::Topology::decoupledPeak:
+        return hardKnee ? selectRangeCore<true, LevelDetector::Topology::decoupledPeak>(numChannels)
+                        : selectRangeCore<false, LevelDetector::Topology::decoupledPeak>(numChannels);
+    case LevelDetector::Topology::rms:
+        return hardKnee ? selectRangeCore<true, LevelDetector::Topology::rms>(numChannels)
+                        : selectRangeCore<false, LevelDetector::Topology::rms>(numChannels);
+    case LevelDetector::Topology::hybrid:
+        return hardKnee ? selectRangeCore<true, LevelDetector::Topology::hybrid>(numChannels)
+                        : selectRangeCore<false, LevelDetector::Topology::hybrid>(numChannels);
+    }
+
+    return &Compressor::processRange;
+}
+
+template <bool hardKnee, LevelDetector::Topology topology>
+Compressor::RangeProcessor Compressor::selectRangeCore(int numChannels) const
+{
+    // Fully wet needs no dry path at all
+    const bool mixActive = mix < 1.0f;
+    if (numChannels == 1)
+        return mixActive ? &Compressor::processRangeCore<hardKnee, topology, 1, true>
+                         : &Compressor::processRangeCore<hardKnee, topology, 1, false>;
+
+    return mixActive ? &Compressor::processRangeCore<hardKnee, topology, 2, true>
+                     : &Compressor::processRangeCore<hardKnee, topology, 2, false>;
+}
+
+template <bool hardKnee, LevelDetector::Topology topology, int numCoreChannels, bool mixActive>
+float Compressor::processRangeCore(float* const* channels, int numChannels, int start, int numSamples,
+                                   float* sidechain, int)
+{
+    jassert(numChannels == numCoreChannels && numGroups == 1);
+
+    int numSources = 0;
+    int sourceStart = 0;
+    const float* const* source = getDetectionSource(channels, numChannels, start, numSamples, numSources,
+                                                    sourceStart);
+
+    // Peak of the group, the one side-chain every channel shares
+    if constexpr (numCoreChannels == 1)
+        FloatVectorOperations::abs(sidechain, source[0] + sourceStart, numSamples);
+    else
+    {
+        const float* left = source[0] + sourceStart;
+        const float* right = source[1 % numSources] + sourceStart;
+        for (int i = 0; i < numSamples; ++i)
+            sidechain[i] = jmax(std::abs(left[i]), std::abs(right[i]));
+    }
+
+    // Level the gain computer sees - peak, windowed RMS or their mean, still linear
+    ballistics[0].applyLevel<topology>(sidechain, numSamples);
+
+    // Compute attenuation - converts side-chain signal from linear to logarithmic domain
+    if constexpr (hardKnee)
+        gainComputer.applyHardKneeCompressionToBuffer(sidechain, numSamples);
+    else
+        gainComputer.applyCompressionToBuffer(sidechain, numSamples);
+
+    // Smooth attenuation - still logarithmic
+    ballistics[0].applyBallistics<topology>(sidechain, numSamples);
+
+    // Get minimum = max. gain reduction from side chain buffer
+    const float minGainReduction = jmin(0.0f, FloatVectorOperations::findMinimum(sidechain, numSamples));
+
+    // Add makeup gain and convert side-chain to linear domain
+    VectorKernels::decibelsToGain(sidechain, makeup, numSamples);
+
+    // Fold dry/wet mix into the gain: x * (mix * g + (1 - mix))
+    if constexpr (mixActive)
+    {
+        FloatVectorOperations::multiply(sidechain, mix, numSamples);
+        FloatVectorOperations::add(sidechain, 1.0f - mix, numSamples);
+    }
+
+    // The side-chain was taken from the undelayed input, delay the audio path by the lookahead
+    lookaheadDelay.process(channels, numChannels, start, numSamples);
+
+    // Multiply attenuation with buffer - apply compression
+    for (int ch = 0; ch < numCoreChannels; ++ch)
+        FloatVectorOperations::multiply(channels[ch] + start, sidechain, numSamples);
+
+    return minGainReduction;
+}
+
+float Compressor::processRange(float* const* channels, int numChannels, int start, int numSamples,
+                               float* sidechain, int sidechainStride)
+{
+    int numSources = 0;
+    int sourceStart = 0;
+    const float* const* source = getDetectionSource(channels, numChannels, start, numSamples, numSources,
+                                                    sourceStart);
+
+    // Fill one side-chain per detection group
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        const int group = channelGroup[ch];
+        const float* src = source[ch % numSources] + sourceStart;
+        float* dst = sidechain + group * sidechainStride;
+
+        if (detectionMode == DetectionMode::rmsLinked)
+        {
+            if (ch == groupFirstChannel[group])
+                FloatVectorOperations::multiply(dst, src, src, numSamples);
+            else
+                FloatVectorOperations::addWithMultiply(dst, src, src, numSamples);
+        }
+        else
+        {
+            if (ch == groupFirstChannel[group])
+                FloatVectorOperations::abs(dst, src, numSamples);
+            else
+                for (int i = 0; i < numSamples; ++i)
+                    dst[i] = jmax(dst[i], std::abs(src[i]));
+        }
+    }
+
+    if (detectionMode == DetectionMode::rmsLinked)
+    {
+        for (int group = 0; group < numGroups; ++group)
+        {
+            float* dst = sidechain + group * sidechainStride;
+            const float scale = 1.0f / static_cast<float>(groupSize[group]);
+            for (int i = 0; i < numSamples; ++i)
+                dst[i] = std::sqrt(dst[i] * scale);
+        }
+    }
+
+    // Level the gain computer sees - peak, windowed RMS or their mean, still linear
+    for (int group = 0; group < numGroups; ++group)
+        ballistics[group].applyLevel(sidechain + group * sidechainStride, numSamples);
+
+    // Compute attenuation - converts side-chain signal from linear to logarithmic domain
+    const bool curveRamping = thresholdSmoother.isSmoothing() || ratioSmoother.isSmoothing()
+                              || kneeSmoother.isSmoothing();
+    if (curveRamping)
+    {
+        // Only reached from the fused engine, numSamples <= fusedBlockSize
+        jassert(numSamples <= fusedBlockSize);
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            gainComputer.setThreshold(thresholdSmoother.getNextValue());
+            gainComputer.setRatio(ratioSmoother.getNextValue());
+            gainComputer.setKnee(kneeSmoother.getNextValue());
+
+            for (int group = 0; group < numGroups; ++group)
+                computeAttenuation(sidechain + group * sidechainStride + i, 1);
+        }
+    }
+    else
+    {
+        for (int group = 0; group < numGroups; ++group)
+            computeAttenuation(sidechain + group * sidechainStride, numSamples);
+    }
+
+    // Per-sample makeup and mix while either of them ramps
+    const bool gainRamping = makeupSmoother.isSmoothing() || mixSmoother.isSmoothing();
+    alignas(32) float makeupRamp[fusedBlockSize];
+    alignas(32) float mixRamp[fusedBlockSize];
+
+    if (gainRamping)
+    {
+        jassert(numSamples <= fusedBlockSize);
 
-        // Get max l/r amplitude values and fill sidechain signal
-        FloatVectorOperations::abs(rawSidechainSignal, buffer.getReadPointer(0), numSamples);
-        FloatVectorOperations::max(rawSidechainSignal, rawSidechainSignal, buffer.getReadPointer(1), numSamples);
+        for (int i = 0; i < numSamples; ++i)
+        {
+            makeupRamp[i] = makeupSmoother.getNextValue();
+            mixRamp[i] = mixSmoother.getNextValue();
+        }
+
+        makeup = makeupSmoother.getCurrentValue();
+        mix = mixSmoother.getCurrentValue();
+    }
+
+    float minGainReduction = 0.0f;
 
-        // Compute attenuation - converts side-chain signal from linear to logarithmic domain
-        gainComputer.applyCompressionToBuffer(rawSidechainSignal, numSamples);
+    for (int group = 0; group < numGroups; ++group)
+    {
+        float* dst = sidechain + group * sidechainStride;
 
         // Smooth attenuation - still logarithmic
-        ballistics.applyBallistics(rawSidechainSignal, numSamples);
+        applyBallistics(group, dst, numSamples);
 
         // Get minimum = max. gain reduction from side chain buffer
-        maxGainReduction = FloatVectorOperations::findMinimum(rawSidechainSignal, numSamples);
+        minGainReduction = jmin(minGainReduction, FloatVectorOperations::findMinimum(dst, numSamples));
 
-        // Add makeup gain and convert side-chain to linear domain
-        for (int i = 0; i < numSamples; ++i)
-            sidechainSignal[i] = Decibels::decibelsToGain(sidechainSignal[i] + makeup);
+        if (gainRamping)
+        {
+            // Add makeup gain, convert to linear domain and fold in the mix per sample
+            FloatVectorOperations::add(dst, makeupRamp, numSamples);
+            decibelsToGain(dst, 0.0f, numSamples);
+
+            for (int i = 0; i < numSamples; ++i)
+                dst[i] = mixRamp[i] * dst[i] + (1.0f - mixRamp[i]);
+        }
+        else
+        {
+            // Add makeup gain and convert side-chain to linear domain
+            decibelsToGain(dst, makeup, numSamples);
 
-        // Copy buffer to original signal
-        for (int i = 0; i < numChannels; ++i)
-            originalSignal.copyFrom(i, 0, buffer, i, 0, numSamples);
+            // Fold dry/wet mix into the gain: x * (mix * g + (1 - mix))
+            applyMixToGain(dst, numSamples);
+        }
+    }
 
-        // Multiply attenuation with buffer - apply compression
-        for (int i = 0; i < numChannels; ++i)
-            FloatVectorOperations::multiply(buffer.getWritePointer(i), rawSidechainSignal, numSamples);
+    // The side-chain was taken from the undelayed input, delay the audio path by the lookahead
+    lookaheadDelay.process(channels, numChannels, start, numSamples);
 
-        // Mix dry & wet signal
-        for (int i = 0; i < numChannels; ++i)
+    // Multiply attenuation with buffer - apply compression
+    for (int ch = 0; ch < numChannels; ++ch)
+        FloatVectorOperations::multiply(channels[ch] + start, sidechain + channelGroup[ch] * sidechainStride,
+                                        numSamples);
+
+    return minGainReduction;
+}
+
+void Compressor::updateGroups(int numChannels)
+{
+    jassert(numChannels <= static_cast<int>(channelGroup.size()));
+    numGroupedChannels = numChannels;
+    numGroups = 0;
+
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        int id = 0;
+        if (detectionMode == DetectionMode::unlinked)
+            id = ch;
+        else if (detectionMode == DetectionMode::grouped && ch < static_cast<int>(customGroups.size()))
+            id = customGroups[ch];
+
+        // Map requested ids to dense group indices in order of first appearance
+        int group = 0;
+        while (group < numGroups && groupId[group] != id)
+            ++group;
+
+        if (group == numGroups)
         {
-            float* channelData = buffer.getWritePointer(i); //wet signal
-            FloatVectorOperations::multiply(channelData, mix, numSamples);
-            FloatVectorOperations::addWithMultiply(channelData, originalSignal.getReadPointer(i), 1 - mix, numSamples);
+            groupId[group] = id;
+            groupFirstChannel[group] = ch;
+            groupSize[group] = 0;
+            ++numGroups;
         }
+
+        channelGroup[ch] = group;
+        ++groupSize[group];
+    }
+}
+
+inline void Compressor::computeAttenuation(float* sidechain, int numSamples)
+{
+    if (exactMode)
+        gainComputer.applyCompressionToBufferReference(sidechain, numSamples);
+    else
+        gainComputer.applyCompressionToBuffer(sidechain, numSamples);
+}
+
+inline void Compressor::applyBallistics(int group, float* sidechain, int numSamples)
+{
+    if (exactMode)
+        ballistics[group].applyBallisticsReference(sidechain, numSamples);
+    else
+        ballistics[group].applyBallistics(sidechain, numSamples);
+}
+
+inline void Compressor::decibelsToGain(float* sidechain, float offsetInDecibels, int numSamples)
+{
+    if (exactMode)
+        VectorKernels::decibelsToGainExact(sidechain, offsetInDecibels, numSamples);
+    else
+        VectorKernels::decibelsToGain(sidechain, offsetInDecibels, numSamples);
+}
+
+bool Compressor::isSmoothing() const
+{
+    return thresholdSmoother.isSmoothing() || ratioSmoother.isSmoothing() || kneeSmoother.isSmoothing()
+           || makeupSmoother.isSmoothing() || mixSmoother.isSmoothing();
+}
+
+void Compressor::resetSmoothers()
+{
+    // Jumps to the targets, only call when not processing
+    for (auto* smoother : {&thresholdSmoother, &ratioSmoother, &kneeSmoother, &makeupSmoother, &mixSmoother})
+        smoother->reset(getProcessingRate(), smoothingTimeInSeconds);
+
+    gainComputer.setThreshold(thresholdSmoother.getTargetValue());
+    gainComputer.setRatio(ratioSmoother.getTargetValue());
+    gainComputer.setKnee(kneeSmoother.getTargetValue());
+    makeup = makeupSmoother.getTargetValue();
+    mix = mixSmoother.getTargetValue();
+}
+
+inline void Compressor::applyMixToGain(float* gain, int numSamples)
+{
+    // Fully wet needs no dry path at all
+    if (mix < 1.0f)
+    {
+        FloatVectorOperations::multiply(gain, mix, numSamples);
+        FloatVectorOperations::add(gain, 1.0f - mix, numSamples);
     }
 }
 
@@ -0,0 +1,73 @@
+/*
+  ==============================================================================
+    File:           DelayLine.cpp
+    Developers:     D. Robert Hoover and Kris Keillor
+    Repository URL: https://github.com/Top-Notch-DSP/GlobeLoveler
+    Date:           2024 Feb 1
+    License:        GNU General Public License, version 3.0 (GPL-3.0)
+  ==============================================================================
+*/
+
+#include "include/DelayLine.h"
+#include "../JuceLibraryCode/JuceHeader.h"
+
+void DelayLine::prepare(int numChannels, int maxDelayInSamples)
+{
+    numChannelsPrepared = jmax(numChannels, 0);
+    capacity = jmax(maxDelayInSamples, 0);
+    storage.assign(static_cast<size_t>(numChannelsPrepared) * capacity, 0.0f);
+    delay = jmin(delay, capacity);
+    position = 0;
+}
+
+void DelayLine::setDelay(int delayInSamples)
+{
+    const int newDelay = jlimit(0, capacity, delayInSamples);
+    if (newDelay != delay)
+    {
+        delay = newDelay;
+        reset();
+    }
+}
+
+int DelayLine::getDelay() const
+{
+    return delay;
+}
+
+void DelayLine::reset()
+{
+    std::fill(storage.begin(), storage.end(), 0.0f);
+    position = 0;
+}
+
+void DelayLine::process(float* const* channels, int numChannels, int start, int numSamples)
+{
+    if (delay == 0)
+        return;
+
+    jassert(numChannels <= numChannelsPrepared);
+    int endPosition = position;
+
+    for (int ch = 0; ch < jmin(numChannels, numChannelsPrepared); ++ch)
+    {
+        float* data = channels[ch] + start;
+        float* line = storage.data() + static_cast<size_t>(ch) * capacity;
+        int pos = position;
+
+        // The oldest sample sits at pos, swapping outputs it and stores the new one in its place.
+        // Runs up to the wrap point are contiguous and vectorise
+        for (int i = 0; i < numSamples;)
+        {
+            const int run = jmin(numSamples - i, delay - pos);
+            std::swap_ranges(data + i, data + i + run, line + pos);
+            i += run;
+            pos += run;
+            if (pos == delay)
+                pos = 0;
+        }
+        endPosition = pos;
+    }
+
+    position = endPosition;
+}
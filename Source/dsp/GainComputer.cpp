@@ -67,7 +67,29 @@ float GainComputer::applyCompression(float& input)
     return slope * overshoot;
 }
 
+VectorKernels::GainCurve GainComputer::getCurve() const
+{
+    const float kneeScale = knee > 0.0f ? 0.5f * slope / knee : 0.0f;
+    return {threshold, kneeHalf, slope, kneeScale};
+}
+
 void GainComputer::applyCompressionToBuffer(float* src, int numSamples)
+{
+    VectorKernels::computeAttenuation(src, numSamples, getCurve());
+}
+
+void GainComputer::applyHardKneeCompressionToBuffer(float* src, int numSamples)
+{
+    jassert(isHardKnee());
+    VectorKernels::computeAttenuationHardKnee(src, numSamples, getCurve());
+}
+
+bool GainComputer::isHardKnee() const
+{
+    return kneeHalf == 0.0f;
+}
+
+void GainComputer::applyCompressionToBufferReference(float* src, int numSamples)
 {
     for (int i = 0; i < numSamples; ++i)
     {
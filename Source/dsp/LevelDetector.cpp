@@ -21,10 +21,48 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 void LevelDetector::prepare(const double& fs)
 {
     sampleRate = fs;
-    alphaAttack = exp(-1.0 / (sampleRate * attackTimeInSeconds));
-    alphaRelease = exp(-1.0 / (sampleRate * releaseTimeInSeconds));
+    alphaAttack = coefficientTable->getCoefficient(attackTimeInSeconds, sampleRate);
+    alphaRelease = coefficientTable->getCoefficient(releaseTimeInSeconds, sampleRate);
+    alphaCrest = coefficientTable->getCoefficient(crestTimeInSeconds, sampleRate);
+    updateReleasePowers();
     state01 = 0.0;
     state02 = 0.0;
+    peakSquare = 0.0;
+    meanSquare = 0.0;
+
+    // Only grows past what setMaximumSampleRate allocated
+    rmsLength = jmax(1, roundToInt(rmsWindowInSeconds * sampleRate));
+    if (static_cast<int>(rmsSquares.size()) < rmsLength)
+        rmsSquares.resize(static_cast<size_t>(rmsLength));
+    resetRmsWindow();
+}
+
+void LevelDetector::setMaximumSampleRate(double maxSampleRate)
+{
+    const auto maxLength = jmax(1, roundToInt(rmsWindowInSeconds * maxSampleRate));
+    if (static_cast<int>(rmsSquares.size()) < maxLength)
+        rmsSquares.resize(static_cast<size_t>(maxLength));
+}
+
+void LevelDetector::setMaximumBlockSize(int maxBlockSize)
+{
+    if (static_cast<int>(crestSquares.size()) < maxBlockSize)
+        crestSquares.resize(static_cast<size_t>(maxBlockSize));
+}
+
+void LevelDetector::setTopology(Topology newTopology)
+{
+    if (newTopology == topology)
+        return;
+
+    topology = newTopology;
+    if (topology == Topology::rms || topology == Topology::hybrid)
+        resetRmsWindow();
+}
+
+LevelDetector::Topology LevelDetector::getTopology() const
+{
+    return topology;
 }
 
 void LevelDetector::setAttack(const double& attack)
@@ -32,7 +70,8 @@ void LevelDetector::setAttack(const double& attack)
     if (attack != attackTimeInSeconds)
     {
         attackTimeInSeconds = attack; //Time it takes to reach 1-1/e = 0.63
-        alphaAttack = exp(-1.0 / (sampleRate * attackTimeInSeconds)); //aA = e^(-1/TA*fs)
+        alphaAttack = coefficientTable->getCoefficient(attackTimeInSeconds, sampleRate); //aA = e^(-1/TA*fs)
+        updateReleasePowers();
     }
 }
 
@@ -41,7 +80,8 @@ void LevelDetector::setRelease(const double& release)
     if (release != releaseTimeInSeconds)
     {
         releaseTimeInSeconds = release; //Time it takes to reach 1 - (1-1/e) = 0.37
-        alphaRelease = exp(-1.0 / (sampleRate * releaseTimeInSeconds)); //aR = e^(-1/TR*fs)
+        alphaRelease = coefficientTable->getCoefficient(releaseTimeInSeconds, sampleRate); //aR = e^(-1/TR*fs)
+        updateReleasePowers();
     }
 }
 
@@ -66,6 +106,37 @@ double LevelDetector::getAlphaRelease()
     return alphaRelease;
 }
 
+void LevelDetector::setAutoAttack(bool shouldBeAutomatic)
+{
+    autoAttack = shouldBeAutomatic;
+}
+
+void LevelDetector::setAutoRelease(bool shouldBeAutomatic)
+{
+    autoRelease = shouldBeAutomatic;
+}
+
+bool LevelDetector::isAutomatic() const
+{
+    return autoAttack || autoRelease;
+}
+
+double LevelDetector::getSettlingTime(double decay) const
+{
+    if (topology == Topology::decoupledPeak)
+        return (attackTimeInSeconds + releaseTimeInSeconds) * decay;
+
+    auto slowestTimeInSeconds = jmax(attackTimeInSeconds * (autoAttack ? 2.0 : 1.0),
+                                     releaseTimeInSeconds * (autoRelease ? 2.0 : 1.0));
+    if (isAutomatic())
+        slowestTimeInSeconds = jmax(slowestTimeInSeconds, crestTimeInSeconds);
+
+    const auto windowInSeconds = topology == Topology::rms || topology == Topology::hybrid
+                                     ? rmsWindowInSeconds
+                                     : 0.0;
+    return slowestTimeInSeconds * decay + windowInSeconds;
+}
+
 float LevelDetector::processPeakBranched(const float& in)
 {
     //Smooth branched peak detector
@@ -80,16 +151,244 @@ float LevelDetector::processPeakBranched(const float& in)
 
 float LevelDetector::processPeakDecoupled(const float& in)
 {
-    //Smooth decoupled peak detector
+    //Smooth decoupled peak detector, the peak of attenuation is its minimum
     const double input = static_cast<double>(in);
-    state02 = jmax(input, alphaRelease * state02 + (1 - alphaRelease) * input);
+    state02 = jmin(input, alphaRelease * state02 + (1 - alphaRelease) * input);
     state01 = alphaAttack * state01 + (1 - alphaAttack) * state02;
     return static_cast<float>(state01);
 }
 
+float LevelDetector::processPeakAuto(const float& in, float crestSquare)
+{
+    // T_A = 2 T_Amax / C^2 and T_R = 2 T_Rmax / C^2 - T_A (Giannoulis, Massberg & Reiss).
+    // Both sides times C^2 give the 1/(T*fs) CoefficientTable is indexed by with one division per sample
+    const double crest = static_cast<double>(crestSquare);
+    const double input = static_cast<double>(in);
+    const double attackTerm = (autoAttack ? 2.0 : crest) * attackTimeInSeconds * sampleRate;
+
+    //Smooth branched peak detector, the direction of the envelope picks the branch
+    if (in < state01)
+    {
+        const double alpha = autoAttack ? coefficientTable->getDecay(crest / attackTerm) : alphaAttack;
+        state01 = alpha * state01 + (1 - alpha) * input;
+    }
+    else
+    {
+        const double releaseTerm = 2.0 * releaseTimeInSeconds * sampleRate - attackTerm;
+        const double alpha = autoRelease ? coefficientTable->getDecay(crest / jmax(crest, releaseTerm))
+                                         : alphaRelease;
+        state01 = alpha * state01 + (1 - alpha) * input;
+    }
+
+    return static_cast<float>(state01);
+}
+
+void LevelDetector::measureCrest(const float* level, int numSamples)
+{
+    jassert(numSamples <= static_cast<int>(crestSquares.size()));
+
+    // Crest factor^2 = peak / mean of the linear level from a peak and a mean square detector.
+    // The peak detector never falls below the mean, so crest^2 >= 1
+    for (int i = 0; i < numSamples; ++i)
+    {
+        const double input = static_cast<double>(level[i]);
+        const double square = input * input;
+        peakSquare = jmax(square, alphaCrest * peakSquare + (1 - alphaCrest) * square);
+        meanSquare = alphaCrest * meanSquare + (1 - alphaCrest) * square;
+        crestSquares[static_cast<size_t>(i)] = static_cast<float>((peakSquare + 1.0e-12) / (meanSquare + 1.0e-12));
+    }
+    numCrestSamples = numSamples;
+}
+
+float LevelDetector::processRmsWindow(const float& in)
+{
+    const float square = in * in;
+    rmsSum += square - rmsSquares[static_cast<size_t>(rmsIndex)];
+    rmsSquares[static_cast<size_t>(rmsIndex)] = square;
+
+    if (++rmsIndex == rmsLength)
+    {
+        // Adding and removing squares rounds the running sum, summing afresh once per window bounds the drift
+        rmsIndex = 0;
+        rmsSum = 0.0;
+        for (int i = 0; i < rmsLength; ++i)
+            rmsSum += rmsSquares[static_cast<size_t>(i)];
+    }
+
+    // Rounding may leave the running sum slightly below 0
+    return static_cast<float>(std::sqrt(jmax(0.0, rmsSum) / rmsLength));
+}
+
+namespace
+{
+    // Detector policies, one per topology and smoothing. The per-sample loop of applyDetector is instantiated
+    // for each, so the buffer loops carry no dispatch
+    struct BranchedPeak
+    {
+        static float process(LevelDetector& detector, float in) { return detector.processPeakBranched(in); }
+    };
+
+    struct DecoupledPeak
+    {
+        static float process(LevelDetector& detector, float in) { return detector.processPeakDecoupled(in); }
+    };
+
+    // Level stages of the RMS and hybrid topologies on the linear side-chain, ahead of the gain computer
+    struct RmsLevel
+    {
+        static float process(LevelDetector& detector, float in) { return detector.processRmsWindow(in); }
+    };
+
+    struct PeakRmsLevel
+    {
+        static float process(LevelDetector& detector, float in)
+        {
+            return 0.5f * (in + detector.processRmsWindow(in));
+        }
+    };
+}
+
+template <typename Detector>
+void LevelDetector::applyDetector(float* src, int numSamples)
+{
+    for (int i = 0; i < numSamples; ++i)
+        src[i] = Detector::process(*this, src[i]);
+}
+
 void LevelDetector::applyBallistics(float* src, int numSamples)
 {
-    // Apply ballistics to src buffer
+    switch (topology)
+    {
+    case Topology::branchedPeak: applyBallistics<Topology::branchedPeak>(src, numSamples); break;
+    case Topology::decoupledPeak: applyBallistics<Topology::decoupledPeak>(src, numSamples); break;
+    case Topology::rms: applyBallistics<Topology::rms>(src, numSamples); break;
+    case Topology::hybrid: applyBallistics<Topology::hybrid>(src, numSamples); break;
+    }
+}
+
+template <LevelDetector::Topology detectorTopology>
+void LevelDetector::applyBallistics(float* src, int numSamples)
+{
+    jassert(detectorTopology == topology);
+
+    if constexpr (detectorTopology == Topology::decoupledPeak)
+    {
+        applyDetector<DecoupledPeak>(src, numSamples);
+        return;
+    }
+
+    // The crest factor of auto mode changes the coefficients every sample
+    if (autoAttack || autoRelease)
+        applyAutoPeak(src, numSamples);
+    else
+        applyBranchedSpeculative(src, numSamples);
+}
+
+template void LevelDetector::applyBallistics<LevelDetector::Topology::branchedPeak>(float*, int);
+template void LevelDetector::applyBallistics<LevelDetector::Topology::decoupledPeak>(float*, int);
+template void LevelDetector::applyBallistics<LevelDetector::Topology::rms>(float*, int);
+template void LevelDetector::applyBallistics<LevelDetector::Topology::hybrid>(float*, int);
+
+void LevelDetector::applyLevel(float* src, int numSamples)
+{
+    switch (topology)
+    {
+    case Topology::branchedPeak: applyLevel<Topology::branchedPeak>(src, numSamples); break;
+    case Topology::decoupledPeak: applyLevel<Topology::decoupledPeak>(src, numSamples); break;
+    case Topology::rms: applyLevel<Topology::rms>(src, numSamples); break;
+    case Topology::hybrid: applyLevel<Topology::hybrid>(src, numSamples); break;
+    }
+}
+
+template <LevelDetector::Topology detectorTopology>
+void LevelDetector::applyLevel(float* src, int numSamples)
+{
+    jassert(detectorTopology == topology);
+
+    // Auto mode follows the crest factor of the level itself, before the RMS window evens it out
+    if (detectorTopology != Topology::decoupledPeak && (autoAttack || autoRelease))
+        measureCrest(src, numSamples);
+
+    if constexpr (detectorTopology == Topology::rms)
+        applyDetector<RmsLevel>(src, numSamples);
+    else if constexpr (detectorTopology == Topology::hybrid)
+        applyDetector<PeakRmsLevel>(src, numSamples);
+}
+
+template void LevelDetector::applyLevel<LevelDetector::Topology::branchedPeak>(float*, int);
+template void LevelDetector::applyLevel<LevelDetector::Topology::decoupledPeak>(float*, int);
+template void LevelDetector::applyLevel<LevelDetector::Topology::rms>(float*, int);
+template void LevelDetector::applyLevel<LevelDetector::Topology::hybrid>(float*, int);
+
+void LevelDetector::applyBallisticsReference(float* src, int numSamples)
+{
+    if (topology == Topology::decoupledPeak)
+        applyDetector<DecoupledPeak>(src, numSamples);
+    else if (autoAttack || autoRelease)
+        applyAutoPeak(src, numSamples);
+    else
+        applyDetector<BranchedPeak>(src, numSamples);
+}
+
+void LevelDetector::applyAutoPeak(float* src, int numSamples)
+{
+    jassert(numSamples <= numCrestSamples);
+
     for (int i = 0; i < numSamples; ++i)
-        src[i] = processPeakBranched(src[i]);
+        src[i] = processPeakAuto(src[i], crestSquares[static_cast<size_t>(i)]);
+}
+
+void LevelDetector::applyBranchedSpeculative(float* src, int numSamples)
+{
+    // processPeakBranched, speculating that every sample releases. With z the zero-state release response of
+    // the group, a release run from state y after sample k - 1 continues as y[i] = z[i] + aR^(i-k+1) (y - z[k-1]),
+    // which does not wait for y[i-1]. The comparison confirms the branch, an attack step restarts the run
+    for (int start = 0; start < numSamples; start += groupSize)
+    {
+        float* x = src + start;
+        const int n = jmin(groupSize, numSamples - start);
+
+        // Independent of the state, so it overlaps with the previous group
+        double zeroState[groupSize];
+        double response = 0.0;
+        for (int i = 0; i < n; ++i)
+        {
+            response = alphaRelease * response + (1 - alphaRelease) * x[i];
+            zeroState[i] = response;
+        }
+
+        double y = state01;
+        double runOffset = state01;
+        int runStart = 0;
+
+        for (int i = 0; i < n; ++i)
+        {
+            if (x[i] < y)
+            {
+                y = alphaAttack * y + (1 - alphaAttack) * x[i];
+                runOffset = y - zeroState[i];
+                runStart = i + 1;
+            }
+            else
+                y = zeroState[i] + releasePowers[i - runStart + 1] * runOffset;
+
+            x[i] = static_cast<float>(y); //y_L
+        }
+
+        state01 = y;
+    }
+}
+
+void LevelDetector::updateReleasePowers()
+{
+    releasePowers[0] = 1.0;
+    for (int k = 1; k <= groupSize; ++k)
+        releasePowers[k] = releasePowers[k - 1] * alphaRelease;
+}
+
+void LevelDetector::resetRmsWindow()
+{
+    std::fill(rmsSquares.begin(), rmsSquares.end(), 0.0f);
+    rmsIndex = 0;
+    rmsSum = 0.0;
 }
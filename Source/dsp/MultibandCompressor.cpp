@@ -0,0 +1,428 @@
+/*
+  ==============================================================================
+    File:           MultibandCompressor.cpp
+    Developers:     D. Robert Hoover and Kris Keillor
+    Repository URL: https://github.com/Top-Notch-DSP/GlobeLoveler
+    Date:           2024 Feb 1
+    License:        GNU General Public License, version 3.0 (GPL-3.0)
+  ==============================================================================
+*/
+
+#include "include/MultibandCompressor.h"
+
+MultibandCompressor::~MultibandCompressor()
+{
+    stopWorkers();
+}
+
+void MultibandCompressor::prepare(double fs, int numChannels, int maxBlockSize, int maxDelayInSamples)
+{
+    numChannelsPrepared = jmax(numChannels, 1);
+    bandStride = jmax(maxBlockSize, 0);
+
+    chains.assign(static_cast<size_t>(maxBands * numChannelsPrepared), ChainState());
+    bandSignal.assign(static_cast<size_t>(maxBands * numChannelsPrepared) * bandStride, 0.0f);
+    bandChannels.resize(static_cast<size_t>(maxBands * numChannelsPrepared));
+    for (size_t i = 0; i < bandChannels.size(); ++i)
+        bandChannels[i] = bandSignal.data() + i * static_cast<size_t>(bandStride);
+
+    bandDelay.prepare(maxBands * numChannelsPrepared, maxDelayInSamples);
+    for (auto& detector : ballistics)
+        detector.setMaximumBlockSize(detectionBlockSize);
+
+    setSampleRate(fs);
+}
+
+void MultibandCompressor::setSampleRate(double fs)
+{
+    sampleRate = fs;
+    updateCrossovers();
+    reset();
+}
+
+void MultibandCompressor::setNumBands(int newNumBands)
+{
+    const int bands = jlimit(minBands, maxBands, newNumBands);
+    if (bands != numBands)
+    {
+        numBands = bands;
+        updateCrossovers();
+        reset();
+    }
+}
+
+int MultibandCompressor::getNumBands() const
+{
+    return numBands;
+}
+
+double MultibandCompressor::getSettlingTime(double decay) const
+{
+    auto settlingTime = 0.0;
+    for (int band = 0; band < numBands; ++band)
+        settlingTime = jmax(settlingTime, ballistics[band].getSettlingTime(decay));
+    return settlingTime;
+}
+
+void MultibandCompressor::setCrossovers(float lowInHz, float highInHz)
+{
+    const float low = jmax(1.0f, lowInHz);
+    const float high = jmax(low, highInHz);
+    if (low != lowCrossoverInHz || high != highCrossoverInHz)
+    {
+        lowCrossoverInHz = low;
+        highCrossoverInHz = high;
+        updateCrossovers();
+    }
+}
+
+void MultibandCompressor::setThreshold(int band, float thresholdInDb)
+{
+    gainComputers[band].setThreshold(thresholdInDb);
+}
+
+void MultibandCompressor::setRatio(int band, float ratio)
+{
+    gainComputers[band].setRatio(ratio);
+}
+
+void MultibandCompressor::setKnee(int band, float kneeInDb)
+{
+    gainComputers[band].setKnee(kneeInDb);
+}
+
+void MultibandCompressor::setMakeup(int band, float makeupGainInDb)
+{
+    makeup[band] = makeupGainInDb;
+}
+
+void MultibandCompressor::setAttack(int band, float attackTimeInMs)
+{
+    ballistics[band].setAttack(attackTimeInMs * 0.001);
+}
+
+void MultibandCompressor::setRelease(int band, float releaseTimeInMs)
+{
+    ballistics[band].setRelease(releaseTimeInMs * 0.001);
+}
+
+void MultibandCompressor::setAutoAttack(int band, bool shouldBeAutomatic)
+{
+    ballistics[band].setAutoAttack(shouldBeAutomatic);
+}
+
+void MultibandCompressor::setAutoRelease(int band, bool shouldBeAutomatic)
+{
+    ballistics[band].setAutoRelease(shouldBeAutomatic);
+}
+
+void MultibandCompressor::setTopology(int band, LevelDetector::Topology topology)
+{
+    ballistics[band].setTopology(topology);
+}
+
+void MultibandCompressor::setMaximumSampleRate(double maxSampleRate)
+{
+    for (auto& detector : ballistics)
+        detector.setMaximumSampleRate(maxSampleRate);
+}
+
+void MultibandCompressor::setMix(float newMix)
+{
+    mix = newMix;
+}
+
+void MultibandCompressor::setLookahead(int delayInSamples)
+{
+    bandDelay.setDelay(delayInSamples);
+}
+
+void MultibandCompressor::setExactMode(bool newExactMode)
+{
+    exactMode = newExactMode;
+}
+
+void MultibandCompressor::setParallelProcessing(bool shouldBeParallel)
+{
+    if (shouldBeParallel == !workers.empty())
+        return;
+
+    if (!shouldBeParallel)
+    {
+        stopWorkers();
+        return;
+    }
+
+    // The calling thread takes tasks too, one worker less than bands keeps every band on its own core
+    for (int i = 0; i < maxBands - 1; ++i)
+        workers.emplace_back(&MultibandCompressor::runWorker, this, generation);
+}
+
+void MultibandCompressor::reset()
+{
+    std::fill(chains.begin(), chains.end(), ChainState());
+    bandDelay.reset();
+    for (auto& detector : ballistics)
+        detector.prepare(sampleRate);
+}
+
+float MultibandCompressor::process(float* const* channels, int numChannels, int numSamples)
+{
+    jassert(numSamples <= bandStride);
+    numChannels = jmin(numChannels, numChannelsPrepared);
+
+    if (!workers.empty() && numSamples >= minParallelBlockSize)
+        splitParallel(channels, numChannels, numSamples);
+    else
+        splitTree(channels, numChannels, numSamples);
+
+    float minGainReduction = 0.0f;
+    for (int start = 0; start < numSamples; start += detectionBlockSize)
+        minGainReduction = jmin(minGainReduction, compressRange(channels, numChannels, start,
+                                                                jmin(detectionBlockSize, numSamples - start)));
+
+    return minGainReduction;
+}
+
+void MultibandCompressor::updateCrossovers()
+{
+    const int numCrossovers = numBands - 1;
+    const double q = 1.0 / MathConstants<double>::sqrt2;
+
+    for (int k = 0; k < numCrossovers; ++k)
+    {
+        // LR4 = two Butterworth sections, their low and high outputs sum to the all-pass with the same q
+        const double position = static_cast<double>(k) / (numCrossovers - 1);
+        const double frequency = lowCrossoverInHz * std::pow(highCrossoverInHz / lowCrossoverInHz, position);
+        lowPass[k] = BlockBiquad::lowPass(sampleRate, frequency, q);
+        highPass[k] = BlockBiquad::highPass(sampleRate, frequency, q);
+        allPass[k] = BlockBiquad::allPass(sampleRate, frequency, q);
+    }
+}
+
+void MultibandCompressor::splitTree(const float* const* channels, int numChannels, int numSamples)
+{
+    // The top band holds what is left above each crossover, its chain owns the shared high-pass state
+    const int top = numBands - 1;
+
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        float* rest = getBand(top, ch);
+        auto& restChain = getChain(top, ch);
+        FloatVectorOperations::copy(rest, channels[ch], numSamples);
+
+        for (int k = 0; k < top; ++k)
+        {
+            float* band = getBand(k, ch);
+            auto& chain = getChain(k, ch);
+            FloatVectorOperations::copy(band, rest, numSamples);
+
+            for (auto& section : chain.lowPass)
+                BlockBiquad::process(lowPass[k], section, band, numSamples);
+            for (auto& section : restChain.highPass[k])
+                BlockBiquad::process(highPass[k], section, rest, numSamples);
+
+            // Bands already split off get this crossover's phase
+            for (int j = 0; j < k; ++j)
+                BlockBiquad::process(allPass[k], getChain(j, ch).allPass[k], getBand(j, ch), numSamples);
+        }
+    }
+}
+
+void MultibandCompressor::splitBand(int band, const float* const* channels, int numChannels, int numSamples)
+{
+    // The same sections in the same order as splitTree, computed from the input
+    const int top = numBands - 1;
+
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        float* data = getBand(band, ch);
+        auto& chain = getChain(band, ch);
+        FloatVectorOperations::copy(data, channels[ch], numSamples);
+
+        for (int k = 0; k < band; ++k)
+            for (auto& section : chain.highPass[k])
+                BlockBiquad::process(highPass[k], section, data, numSamples);
+
+        if (band < top)
+            for (auto& section : chain.lowPass)
+                BlockBiquad::process(lowPass[band], section, data, numSamples);
+
+        for (int k = band + 1; k < top; ++k)
+            BlockBiquad::process(allPass[k], chain.allPass[k], data, numSamples);
+    }
+}
+
+void MultibandCompressor::splitParallel(const float* const* channels, int numChannels, int numSamples)
+{
+    // Every band repeats the high-passes below it, starting from the top band's state
+    const int top = numBands - 1;
+    for (int ch = 0; ch < numChannels; ++ch)
+        for (int band = 1; band < top; ++band)
+            for (int k = 0; k < band; ++k)
+            {
+                getChain(band, ch).highPass[k][0] = getChain(top, ch).highPass[k][0];
+                getChain(band, ch).highPass[k][1] = getChain(top, ch).highPass[k][1];
+            }
+
+    {
+        std::lock_guard<std::mutex> lock(workerMutex);
+        taskChannels = channels;
+        taskNumChannels = numChannels;
+        taskNumSamples = numSamples;
+        unfinishedTasks = numBands;
+        nextTask.store(0);
+        ++generation;
+    }
+    workAvailable.notify_all();
+
+    runSplitTasks();
+
+    std::unique_lock<std::mutex> lock(workerMutex);
+    workFinished.wait(lock, [this] { return unfinishedTasks == 0; });
+}
+
+void MultibandCompressor::runWorker(int seenGeneration)
+{
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(workerMutex);
+            workAvailable.wait(lock, [&] { return stopping || generation != seenGeneration; });
+            if (stopping)
+                return;
+            seenGeneration = generation;
+        }
+
+        runSplitTasks();
+    }
+}
+
+void MultibandCompressor::runSplitTasks()
+{
+    for (int band = nextTask.fetch_add(1); band < numBands; band = nextTask.fetch_add(1))
+    {
+        splitBand(band, taskChannels, taskNumChannels, taskNumSamples);
+
+        std::lock_guard<std::mutex> lock(workerMutex);
+        if (--unfinishedTasks == 0)
+            workFinished.notify_one();
+    }
+}
+
+void MultibandCompressor::stopWorkers()
+{
+    {
+        std::lock_guard<std::mutex> lock(workerMutex);
+        stopping = true;
+    }
+    workAvailable.notify_all();
+
+    for (auto& worker : workers)
+        worker.join();
+
+    workers.clear();
+    stopping = false;
+}
+
+float MultibandCompressor::compressRange(float* const* channels, int numChannels, int start, int numSamples)
+{
+    constexpr int lanes = VectorKernels::laneCount;
+    static_assert(maxBands <= lanes, "Every band needs a lane");
+
+    // Linked peak of every band, then the level its topology's gain computer sees, still linear
+    alignas(32) float gains[maxBands][detectionBlockSize];
+    for (int band = 0; band < numBands; ++band)
+    {
+        FloatVectorOperations::clear(gains[band], numSamples);
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            const float* src = getBand(band, ch) + start;
+            for (int i = 0; i < numSamples; ++i)
+                gains[band][i] = jmax(gains[band][i], std::abs(src[i]));
+        }
+
+        ballistics[band].applyLevel(gains[band], numSamples);
+    }
+
+    // One frame per sample. Lanes without a band stay silent
+    alignas(32) float frames[detectionBlockSize * lanes];
+    FloatVectorOperations::clear(frames, numSamples * lanes);
+    for (int band = 0; band < numBands; ++band)
+        for (int i = 0; i < numSamples; ++i)
+            frames[i * lanes + band] = gains[band][i];
+
+    // Compute attenuation of all bands at once - converts the frames from linear to logarithmic domain
+    if (exactMode)
+    {
+        for (int i = 0; i < numSamples; ++i)
+            for (int band = 0; band < numBands; ++band)
+                gainComputers[band].applyCompressionToBufferReference(frames + i * lanes + band, 1);
+    }
+    else
+    {
+        VectorKernels::LaneCurves curves;
+        for (int lane = 0; lane < lanes; ++lane)
+        {
+            const auto curve = gainComputers[jmin(lane, numBands - 1)].getCurve();
+            curves.threshold[lane] = curve.threshold;
+            curves.kneeHalf[lane] = curve.kneeHalf;
+            curves.slope[lane] = curve.slope;
+            curves.kneeScale[lane] = curve.kneeScale;
+        }
+        VectorKernels::computeAttenuationLanes(frames, numSamples, curves);
+    }
+
+    // One run of attenuation per band, so every detector smooths a whole block with its own topology
+    for (int band = 0; band < numBands; ++band)
+        for (int i = 0; i < numSamples; ++i)
+            gains[band][i] = frames[i * lanes + band];
+
+    float minGainReduction = 0.0f;
+    for (int band = 0; band < numBands; ++band)
+    {
+        // Smooth attenuation - still logarithmic
+        if (exactMode)
+            ballistics[band].applyBallisticsReference(gains[band], numSamples);
+        else
+            ballistics[band].applyBallistics(gains[band], numSamples);
+        minGainReduction = jmin(minGainReduction, FloatVectorOperations::findMinimum(gains[band], numSamples));
+
+        // Add makeup gain and convert to linear domain
+        if (exactMode)
+            VectorKernels::decibelsToGainExact(gains[band], makeup[band], numSamples);
+        else
+            VectorKernels::decibelsToGain(gains[band], makeup[band], numSamples);
+
+        // Fold dry/wet mix into the gain: x * (mix * g + (1 - mix))
+        if (mix < 1.0f)
+        {
+            FloatVectorOperations::multiply(gains[band], mix, numSamples);
+            FloatVectorOperations::add(gains[band], 1.0f - mix, numSamples);
+        }
+    }
+
+    // The detection saw the undelayed bands, delay them by the lookahead
+    bandDelay.process(bandChannels.data(), numBands * numChannelsPrepared, start, numSamples);
+
+    // Sum the compressed bands straight into the channels
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        float* dst = channels[ch] + start;
+        FloatVectorOperations::multiply(dst, getBand(0, ch) + start, gains[0], numSamples);
+        for (int band = 1; band < numBands; ++band)
+            FloatVectorOperations::addWithMultiply(dst, getBand(band, ch) + start, gains[band], numSamples);
+    }
+
+    return minGainReduction;
+}
+
+MultibandCompressor::ChainState& MultibandCompressor::getChain(int band, int channel)
+{
+    return chains[static_cast<size_t>(band * numChannelsPrepared + channel)];
+}
+
+float* MultibandCompressor::getBand(int band, int channel)
+{
+    return bandChannels[static_cast<size_t>(band * numChannelsPrepared + channel)];
+}
@@ -0,0 +1,99 @@
+/*
+  ==============================================================================
+    File:           SidechainFilter.cpp
+    Developers:     D. Robert Hoover and Kris Keillor
+    Repository URL: https://github.com/Top-Notch-DSP/GlobeLoveler
+    Date:           2024 Feb 1
+    License:        GNU General Public License, version 3.0 (GPL-3.0)
+  ==============================================================================
+*/
+
+#include "include/SidechainFilter.h"
+
+void SidechainFilter::prepare(double fs, int numChannels)
+{
+    highPassState.assign(static_cast<size_t>(jmax(numChannels, 1)), BlockBiquad::State());
+    tiltState.assign(highPassState.size(), BlockBiquad::State());
+    setSampleRate(fs);
+}
+
+void SidechainFilter::setSampleRate(double fs)
+{
+    sampleRate = fs;
+    updateCoefficients();
+    reset();
+}
+
+void SidechainFilter::setHighPass(float frequencyInHz)
+{
+    const auto newFrequency = jmax(0.0f, frequencyInHz);
+    if (newFrequency != highPassInHz)
+    {
+        highPassInHz = newFrequency;
+        updateCoefficients();
+    }
+}
+
+void SidechainFilter::setTilt(float decibels)
+{
+    if (decibels != tiltInDecibels)
+    {
+        tiltInDecibels = decibels;
+        updateCoefficients();
+    }
+}
+
+bool SidechainFilter::isActive() const
+{
+    return highPassInHz > 0.0f || tiltInDecibels != 0.0f;
+}
+
+void SidechainFilter::reset()
+{
+    std::fill(highPassState.begin(), highPassState.end(), BlockBiquad::State());
+    std::fill(tiltState.begin(), tiltState.end(), BlockBiquad::State());
+}
+
+void SidechainFilter::process(int channel, float* data, int numSamples)
+{
+    jassert(channel < static_cast<int>(highPassState.size()));
+
+    auto& highPassChannel = highPassState[static_cast<size_t>(channel)];
+    auto& tiltChannel = tiltState[static_cast<size_t>(channel)];
+
+    // Both sections per sub-block, the data stays in L1 cache between them
+    for (int start = 0; start < numSamples; start += BlockBiquad::blockSize)
+    {
+        const int n = jmin(BlockBiquad::blockSize, numSamples - start);
+
+        if (highPassInHz > 0.0f)
+            BlockBiquad::process(highPass, highPassChannel, data + start, n);
+        if (tiltInDecibels != 0.0f)
+            BlockBiquad::process(tilt, tiltChannel, data + start, n);
+    }
+}
+
+void SidechainFilter::updateCoefficients()
+{
+    if (highPassInHz > 0.0f)
+        highPass = BlockBiquad::highPass(sampleRate, highPassInHz, 1.0 / MathConstants<double>::sqrt2);
+
+    if (tiltInDecibels != 0.0f)
+    {
+        // RBJ high shelf with slope 1
+        const double A = std::pow(10.0, tiltInDecibels / 40.0);
+        const double w0 = MathConstants<double>::twoPi * jmin(static_cast<double>(tiltPivotInHz), 0.49 * sampleRate)
+                          / sampleRate;
+        const double cosW0 = std::cos(w0);
+        const double alpha = std::sin(w0) * 0.5 * MathConstants<double>::sqrt2;
+        const double twoSqrtAAlpha = 2.0 * std::sqrt(A) * alpha;
+
+        // High shelf of +tilt pulled down by tilt/2 (a factor 1/A), which cancels the cookbook's A in b
+        tilt = BlockBiquad::make((A + 1.0) + (A - 1.0) * cosW0 + twoSqrtAAlpha,
+                                 -2.0 * ((A - 1.0) + (A + 1.0) * cosW0),
+                                 (A + 1.0) + (A - 1.0) * cosW0 - twoSqrtAAlpha,
+                                 (A + 1.0) - (A - 1.0) * cosW0 + twoSqrtAAlpha,
+                                 2.0 * ((A - 1.0) - (A + 1.0) * cosW0),
+                                 (A + 1.0) - (A - 1.0) * cosW0 - twoSqrtAAlpha);
+    }
+}
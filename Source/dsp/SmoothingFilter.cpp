@@ -16,11 +16,13 @@ You should have received a copy of the GNU General Public License
 along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 #include "include/SmoothingFilter.h"
+#include "include/CoefficientTable.h"
 #include "../JuceLibraryCode/JuceHeader.h"
 
 void SmoothingFilter::prepare(const double& fs)
 {
     sampleRate = fs;
+    CoefficientTable::getInstance(); // Built here, never on the audio thread
     a1 = 1;
     b1 = 1 - a1;
 }
@@ -48,6 +50,6 @@ void SmoothingFilter::setAlpha(double a)
 
 void SmoothingFilter::setAlphaWithTime(float timeInSeconds)
 {
-    a1 = exp(-1.0 / (sampleRate * timeInSeconds));
+    a1 = CoefficientTable::getInstance().getCoefficient(timeInSeconds, sampleRate);
     b1 = 1 - a1;
 }
@@ -0,0 +1,233 @@
+/*
+  ==============================================================================
+    File:           TruePeakLimiter.cpp
+    Developers:     D. Robert Hoover and Kris Keillor
+    Repository URL: https://github.com/Top-Notch-DSP/GlobeLoveler
+    Date:           2024 Feb 1
+    License:        GNU General Public License, version 3.0 (GPL-3.0)
+  ==============================================================================
+*/
+
+#include "include/TruePeakLimiter.h"
+#include "include/CoefficientTable.h"
+
+// The interpolated interval [m, m + 1) needs tapsPerPhase / 2 samples after m,
+// so the peak detection lags the input by that much
+static constexpr int interpolationDelay = TruePeakLimiter::tapsPerPhase / 2;
+
+void TruePeakLimiter::prepare(const dsp::ProcessSpec& ps)
+{
+    procSpec = ps;
+    const auto numChannels = static_cast<int>(jmax(ps.numChannels, 1u));
+    const auto maxBlockSize = static_cast<int>(ps.maximumBlockSize);
+
+    computeInterpolationFilters();
+    CoefficientTable::getInstance(); // Built here, never on the audio thread
+
+    historyStride = tapsPerPhase - 1 + maxBlockSize;
+    history.assign(static_cast<size_t>(numChannels) * historyStride, 0.0f);
+    truePeak.assign(maxBlockSize, 0.0f);
+    interpolated.assign(maxBlockSize, 0.0f);
+    gain.assign(maxBlockSize, 1.0f);
+
+    windowLength = jmax(1, roundToInt(lookaheadInMs * 0.001 * ps.sampleRate));
+    minimum.prepare(windowLength);
+    averageWindow.assign(windowLength, 1.0f);
+
+    // Gain at the output of the average belongs to the sample windowLength - 1 behind the newest peak
+    delay.prepare(numChannels, windowLength - 1 + interpolationDelay);
+    delay.setDelay(windowLength - 1 + interpolationDelay);
+
+    setRelease(static_cast<float>(releaseTimeInSeconds * 1000.0));
+    reset();
+}
+
+void TruePeakLimiter::setCeiling(float ceilingInDb)
+{
+    ceiling = Decibels::decibelsToGain(ceilingInDb);
+}
+
+void TruePeakLimiter::setRelease(float releaseTimeInMs)
+{
+    releaseTimeInSeconds = jmax(0.001, releaseTimeInMs * 0.001);
+    if (procSpec.sampleRate > 0.0)
+        releaseCoefficient = static_cast<float>(CoefficientTable::getInstance().getCoefficient(
+            releaseTimeInSeconds, procSpec.sampleRate));
+}
+
+void TruePeakLimiter::reset()
+{
+    std::fill(history.begin(), history.end(), 0.0f);
+    std::fill(averageWindow.begin(), averageWindow.end(), 1.0f);
+    averageSum = static_cast<double>(windowLength);
+    averagePosition = 0;
+    minimum.reset();
+    delay.reset();
+    releaseState = 1.0f;
+    maxGainReduction = 0.0f;
+}
+
+int TruePeakLimiter::getLatencySamples() const
+{
+    return delay.getDelay();
+}
+
+int64 TruePeakLimiter::getSettlingSamples(float maxErrorInDecibels, float maxAttenuationInDecibels) const
+{
+    jassert(maxErrorInDecibels > 0.0f && procSpec.sampleRate > 0.0);
+
+    // The release contracts a linear gain difference by releaseCoefficient per sample, a difference e
+    // at gain g is about 8.69 * e / g dB. Window and average forget everything older than two windows
+    const auto minGain = Decibels::decibelsToGain(-static_cast<double>(maxAttenuationInDecibels));
+    const auto decay = std::log(jmax(1.0, 8.69 / (minGain * maxErrorInDecibels)));
+    return 2 * windowLength + static_cast<int64>(std::ceil(releaseTimeInSeconds * procSpec.sampleRate * decay));
+}
+
+float TruePeakLimiter::getMaxGainReduction() const
+{
+    return maxGainReduction;
+}
+
+void TruePeakLimiter::process(AudioBuffer<float>& buffer)
+{
+    const auto numSamples = buffer.getNumSamples();
+    const auto numChannels = jmin(buffer.getNumChannels(), static_cast<int>(history.size() / jmax(historyStride, 1)));
+    float* const* channels = buffer.getArrayOfWritePointers();
+
+    jassert(numSamples <= static_cast<int>(procSpec.maximumBlockSize));
+
+    detectTruePeak(channels, numChannels, numSamples);
+
+    // Gain envelope, sequential by nature: hold the minimum, release, average over the window
+    const float invWindow = 1.0f / static_cast<float>(windowLength);
+    float minGain = 1.0f;
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        const float required = truePeak[i] > ceiling ? ceiling / truePeak[i] : 1.0f;
+        const float held = minimum.push(required);
+
+        releaseState = jmin(held, 1.0f - (1.0f - releaseState) * releaseCoefficient);
+
+        averageSum += releaseState - averageWindow[averagePosition];
+        averageWindow[averagePosition] = releaseState;
+        if (++averagePosition == windowLength)
+            averagePosition = 0;
+
+        gain[i] = static_cast<float>(averageSum) * invWindow;
+        minGain = jmin(minGain, gain[i]);
+    }
+
+    // A long running sum drifts, resynchronise it once per block
+    averageSum = 0.0;
+    for (const auto value : averageWindow)
+        averageSum += value;
+
+    maxGainReduction = Decibels::gainToDecibels(minGain);
+
+    delay.process(channels, numChannels, 0, numSamples);
+    for (int ch = 0; ch < numChannels; ++ch)
+        FloatVectorOperations::multiply(channels[ch], gain.data(), numSamples);
+}
+
+void TruePeakLimiter::detectTruePeak(const float* const* channels, int numChannels, int numSamples)
+{
+    constexpr int numPrevious = tapsPerPhase - 1;
+
+    if (numChannels == 0)
+        FloatVectorOperations::clear(truePeak.data(), numSamples);
+
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        float* hist = history.data() + static_cast<size_t>(ch) * historyStride;
+        FloatVectorOperations::copy(hist + numPrevious, channels[ch], numSamples);
+
+        // The sample at the start of each interpolated interval, interpolationDelay behind the input
+        const float* current = hist + interpolationDelay - 1;
+        if (ch == 0)
+            FloatVectorOperations::abs(truePeak.data(), current, numSamples);
+        else
+            for (int i = 0; i < numSamples; ++i)
+                truePeak[i] = jmax(truePeak[i], std::abs(current[i]));
+
+        // One polyphase branch per position between two samples, tap-major so every pass is a vector op
+        for (int phase = 0; phase < oversamplingFactor - 1; ++phase)
+        {
+            FloatVectorOperations::multiply(interpolated.data(), hist, coefficients[phase][0], numSamples);
+            for (int tap = 1; tap < tapsPerPhase; ++tap)
+                FloatVectorOperations::addWithMultiply(interpolated.data(), hist + tap, coefficients[phase][tap], numSamples);
+
+            for (int i = 0; i < numSamples; ++i)
+                truePeak[i] = jmax(truePeak[i], std::abs(interpolated[i]));
+        }
+
+        // Keep the tail for the next block
+        std::memmove(hist, hist + numSamples, sizeof(float) * numPrevious);
+    }
+}
+
+void TruePeakLimiter::computeInterpolationFilters()
+{
+    // Value at m + phase/4 from the samples m - (tapsPerPhase/2 - 1) ... m + tapsPerPhase/2,
+    // sinc with a Hann window spanning the taps, every branch normalised to unity gain at DC
+    const double halfWidth = tapsPerPhase / 2.0;
+
+    for (int phase = 1; phase < oversamplingFactor; ++phase)
+    {
+        const double fraction = static_cast<double>(phase) / oversamplingFactor;
+        double sum = 0.0;
+        double taps[tapsPerPhase];
+
+        for (int tap = 0; tap < tapsPerPhase; ++tap)
+        {
+            const double x = fraction - (tap - (interpolationDelay - 1));
+            const double sinc = std::sin(MathConstants<double>::pi * x) / (MathConstants<double>::pi * x);
+            const double window = 0.5 + 0.5 * std::cos(MathConstants<double>::pi * x / halfWidth);
+            taps[tap] = sinc * window;
+            sum += taps[tap];
+        }
+
+        for (int tap = 0; tap < tapsPerPhase; ++tap)
+            coefficients[phase - 1][tap] = static_cast<float>(taps[tap] / sum);
+    }
+}
+
+//==============================================================================
+void TruePeakLimiter::SlidingMinimum::prepare(int windowLength)
+{
+    window = jmax(1, windowLength);
+    indices.assign(window + 1, 0);
+    values.assign(window + 1, 0.0f);
+    reset();
+}
+
+void TruePeakLimiter::SlidingMinimum::reset()
+{
+    head = 0;
+    size = 0;
+    count = 0;
+}
+
+float TruePeakLimiter::SlidingMinimum::push(float value)
+{
+    const int capacity = static_cast<int>(values.size());
+
+    // Values behind the new one that are not smaller can never be the minimum again
+    while (size > 0 && values[(head + size - 1) % capacity] >= value)
+        --size;
+
+    const int tail = (head + size) % capacity;
+    indices[tail] = count;
+    values[tail] = value;
+    ++size;
+
+    // Drop the front once it left the window
+    if (indices[head] <= count - window)
+    {
+        head = (head + 1) % capacity;
+        --size;
+    }
+
+    ++count;
+    return values[head];
+}
@@ -0,0 +1,596 @@
+/*
+  ==============================================================================
+    File:           VectorKernels.cpp
+    Developers:     D. Robert Hoover and Kris Keillor
+    Repository URL: https://github.com/Top-Notch-DSP/GlobeLoveler
+    Date:           2024 Feb 1
+    License:        GNU General Public License, version 3.0 (GPL-3.0)
+  ==============================================================================
+*/
+
+#include "include/VectorKernels.h"
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <cstring>
+
+#if JUCE_INTEL
+    #include <immintrin.h>
+    #if defined(__GNUC__)
+        #define VECTOR_KERNELS_SSE2 __attribute__((target("sse2")))
+        #define VECTOR_KERNELS_AVX2 __attribute__((target("avx2,fma")))
+    #else
+        #define VECTOR_KERNELS_SSE2
+        #define VECTOR_KERNELS_AVX2
+    #endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    #include <arm_neon.h>
+    #define VECTOR_KERNELS_NEON 1
+#endif
+
+namespace VectorKernels
+{
+namespace
+{
+    // 20 * log10(2), converts log2 to dB
+    constexpr float dbPerOctave = 6.02059991f;
+    constexpr float minLevel = 1e-6f;
+    constexpr float minusInfinityDb = -100.0f;
+
+    // Minimax fit of log2(1 + t) / t on t = [0, 1)
+    constexpr float log2C0 = 1.442553144f;
+    constexpr float log2C1 = -0.7182819062f;
+    constexpr float log2C2 = 0.4582707481f;
+    constexpr float log2C3 = -0.2795380223f;
+    constexpr float log2C4 = 0.1234513811f;
+    constexpr float log2C5 = -0.02645741343f;
+
+    // log2(10) / 20, converts dB to log2
+    constexpr float octavesPerDb = 0.166096405f;
+    // Keeps 2^n inside the range of normalized floats
+    constexpr float maxExponent = 126.0f;
+
+    // Minimax fit of 2^t on t = [0, 1)
+    constexpr float exp2C0 = 0.9999998931f;
+    constexpr float exp2C1 = 0.6931547525f;
+    constexpr float exp2C2 = 0.2401397111f;
+    constexpr float exp2C3 = 0.05586624615f;
+    constexpr float exp2C4 = 0.008942829155f;
+    constexpr float exp2C5 = 0.001896461077f;
+
+    //==============================================================================
+    // Scalar versions, used for the remainder of a buffer so every lane of a block
+    // is computed by the same approximation
+    inline float fastLog2(float x)
+    {
+        uint32_t bits;
+        std::memcpy(&bits, &x, sizeof(bits));
+        const float exponent = static_cast<float>(static_cast<int>((bits >> 23) & 0xff) - 127);
+        bits = (bits & 0x007fffffu) | 0x3f800000u;
+        float mantissa;
+        std::memcpy(&mantissa, &bits, sizeof(mantissa));
+
+        const float t = mantissa - 1.0f;
+        float p = log2C5;
+        p = p * t + log2C4;
+        p = p * t + log2C3;
+        p = p * t + log2C2;
+        p = p * t + log2C1;
+        p = p * t + log2C0;
+        return exponent + p * t;
+    }
+
+    inline float attenuation(float in, const GainCurve& c)
+    {
+        const float level = std::max(std::abs(in), minLevel);
+        const float levelInDecibels = std::max(fastLog2(level) * dbPerOctave, minusInfinityDb);
+        const float overshoot = levelInDecibels - c.threshold;
+
+        if (overshoot <= -c.kneeHalf)
+            return 0.0f;
+        if (overshoot <= c.kneeHalf)
+            return c.kneeScale * (overshoot + c.kneeHalf) * (overshoot + c.kneeHalf);
+        return c.slope * overshoot;
+    }
+
+    inline float attenuationHardKnee(float in, const GainCurve& c)
+    {
+        const float level = std::max(std::abs(in), minLevel);
+        const float levelInDecibels = std::max(fastLog2(level) * dbPerOctave, minusInfinityDb);
+        const float overshoot = levelInDecibels - c.threshold;
+        return overshoot <= 0.0f ? 0.0f : c.slope * overshoot;
+    }
+
+    void computeAttenuationScalar(float* src, int numSamples, const GainCurve& curve)
+    {
+        for (int i = 0; i < numSamples; ++i)
+            src[i] = attenuation(src[i], curve);
+    }
+
+    void computeAttenuationHardKneeScalar(float* src, int numSamples, const GainCurve& curve)
+    {
+        for (int i = 0; i < numSamples; ++i)
+            src[i] = attenuationHardKnee(src[i], curve);
+    }
+
+    void computeAttenuationLanesScalar(float* frames, int numFrames, const LaneCurves& c)
+    {
+        for (int i = 0; i < numFrames; ++i)
+            for (int lane = 0; lane < laneCount; ++lane)
+                frames[i * laneCount + lane] = attenuation(frames[i * laneCount + lane],
+                                                           {c.threshold[lane], c.kneeHalf[lane],
+                                                            c.slope[lane], c.kneeScale[lane]});
+    }
+
+    inline float fastExp2(float x)
+    {
+        x = std::min(std::max(x, -maxExponent), maxExponent);
+        const float integer = std::floor(x);
+        const float t = x - integer;
+
+        float p = exp2C5;
+        p = p * t + exp2C4;
+        p = p * t + exp2C3;
+        p = p * t + exp2C2;
+        p = p * t + exp2C1;
+        p = p * t + exp2C0;
+
+        const uint32_t scaleBits = static_cast<uint32_t>(static_cast<int>(integer) + 127) << 23;
+        float scale;
+        std::memcpy(&scale, &scaleBits, sizeof(scale));
+        return p * scale;
+    }
+
+    void decibelsToGainScalar(float* src, float offsetInDecibels, int numSamples)
+    {
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const float gainInDecibels = src[i] + offsetInDecibels;
+            src[i] = gainInDecibels > minusInfinityDb ? fastExp2(gainInDecibels * octavesPerDb) : 0.0f;
+        }
+    }
+
+    //==============================================================================
+#if JUCE_INTEL
+    VECTOR_KERNELS_SSE2 inline __m128 fastLog2(__m128 x)
+    {
+        const __m128i bits = _mm_castps_si128(x);
+        const __m128i biased = _mm_and_si128(_mm_srli_epi32(bits, 23), _mm_set1_epi32(0xff));
+        const __m128 exponent = _mm_cvtepi32_ps(_mm_sub_epi32(biased, _mm_set1_epi32(127)));
+        const __m128i mantissaBits = _mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x007fffff)),
+                                                  _mm_set1_epi32(0x3f800000));
+        const __m128 t = _mm_sub_ps(_mm_castsi128_ps(mantissaBits), _mm_set1_ps(1.0f));
+
+        __m128 p = _mm_set1_ps(log2C5);
+        p = _mm_add_ps(_mm_mul_ps(p, t), _mm_set1_ps(log2C4));
+        p = _mm_add_ps(_mm_mul_ps(p, t), _mm_set1_ps(log2C3));
+        p = _mm_add_ps(_mm_mul_ps(p, t), _mm_set1_ps(log2C2));
+        p = _mm_add_ps(_mm_mul_ps(p, t), _mm_set1_ps(log2C1));
+        p = _mm_add_ps(_mm_mul_ps(p, t), _mm_set1_ps(log2C0));
+        return _mm_add_ps(exponent, _mm_mul_ps(p, t));
+    }
+
+    VECTOR_KERNELS_SSE2 inline __m128 attenuation(__m128 in, __m128 threshold, __m128 kneeHalf, __m128 slope,
+                                                  __m128 kneeScale)
+    {
+        const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+        const __m128 level = _mm_max_ps(_mm_and_ps(in, signMask), _mm_set1_ps(minLevel));
+        const __m128 levelInDecibels = _mm_max_ps(_mm_mul_ps(fastLog2(level), _mm_set1_ps(dbPerOctave)),
+                                                  _mm_set1_ps(minusInfinityDb));
+        const __m128 overshoot = _mm_sub_ps(levelInDecibels, threshold);
+
+        const __m128 hard = _mm_mul_ps(slope, overshoot);
+        const __m128 kneeOffset = _mm_add_ps(overshoot, kneeHalf);
+        const __m128 soft = _mm_mul_ps(_mm_mul_ps(kneeScale, kneeOffset), kneeOffset);
+
+        // Select knee or linear segment, then zero everything below the knee
+        const __m128 inKnee = _mm_cmple_ps(overshoot, kneeHalf);
+        const __m128 below = _mm_cmple_ps(overshoot, _mm_sub_ps(_mm_setzero_ps(), kneeHalf));
+        const __m128 result = _mm_or_ps(_mm_and_ps(inKnee, soft), _mm_andnot_ps(inKnee, hard));
+        return _mm_andnot_ps(below, result);
+    }
+
+    // attenuation with a knee of zero width: the linear segment above the threshold, zero below
+    VECTOR_KERNELS_SSE2 inline __m128 attenuationHardKnee(__m128 in, __m128 threshold, __m128 slope)
+    {
+        const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+        const __m128 level = _mm_max_ps(_mm_and_ps(in, signMask), _mm_set1_ps(minLevel));
+        const __m128 levelInDecibels = _mm_max_ps(_mm_mul_ps(fastLog2(level), _mm_set1_ps(dbPerOctave)),
+                                                  _mm_set1_ps(minusInfinityDb));
+        const __m128 overshoot = _mm_sub_ps(levelInDecibels, threshold);
+        return _mm_andnot_ps(_mm_cmple_ps(overshoot, _mm_setzero_ps()), _mm_mul_ps(slope, overshoot));
+    }
+
+    VECTOR_KERNELS_SSE2 void computeAttenuationSSE2(float* src, int numSamples, const GainCurve& c)
+    {
+        const __m128 threshold = _mm_set1_ps(c.threshold);
+        const __m128 kneeHalf = _mm_set1_ps(c.kneeHalf);
+        const __m128 slope = _mm_set1_ps(c.slope);
+        const __m128 kneeScale = _mm_set1_ps(c.kneeScale);
+
+        int i = 0;
+        for (; i + 4 <= numSamples; i += 4)
+            _mm_storeu_ps(src + i, attenuation(_mm_loadu_ps(src + i), threshold, kneeHalf, slope, kneeScale));
+
+        computeAttenuationScalar(src + i, numSamples - i, c);
+    }
+
+    VECTOR_KERNELS_SSE2 void computeAttenuationHardKneeSSE2(float* src, int numSamples, const GainCurve& c)
+    {
+        const __m128 threshold = _mm_set1_ps(c.threshold);
+        const __m128 slope = _mm_set1_ps(c.slope);
+
+        int i = 0;
+        for (; i + 4 <= numSamples; i += 4)
+            _mm_storeu_ps(src + i, attenuationHardKnee(_mm_loadu_ps(src + i), threshold, slope));
+
+        computeAttenuationHardKneeScalar(src + i, numSamples - i, c);
+    }
+
+    VECTOR_KERNELS_SSE2 void computeAttenuationLanesSSE2(float* frames, int numFrames, const LaneCurves& c)
+    {
+        // Two registers per frame, the curves stay in registers for the whole buffer
+        const __m128 thresholdLow = _mm_load_ps(c.threshold), thresholdHigh = _mm_load_ps(c.threshold + 4);
+        const __m128 kneeHalfLow = _mm_load_ps(c.kneeHalf), kneeHalfHigh = _mm_load_ps(c.kneeHalf + 4);
+        const __m128 slopeLow = _mm_load_ps(c.slope), slopeHigh = _mm_load_ps(c.slope + 4);
+        const __m128 kneeScaleLow = _mm_load_ps(c.kneeScale), kneeScaleHigh = _mm_load_ps(c.kneeScale + 4);
+
+        for (int i = 0; i < numFrames; ++i)
+        {
+            float* frame = frames + i * laneCount;
+            _mm_storeu_ps(frame, attenuation(_mm_loadu_ps(frame), thresholdLow, kneeHalfLow, slopeLow, kneeScaleLow));
+            _mm_storeu_ps(frame + 4, attenuation(_mm_loadu_ps(frame + 4), thresholdHigh, kneeHalfHigh, slopeHigh,
+                                                 kneeScaleHigh));
+        }
+    }
+
+    VECTOR_KERNELS_SSE2 inline __m128 fastExp2(__m128 x)
+    {
+        x = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(-maxExponent)), _mm_set1_ps(maxExponent));
+
+        // floor() via truncation, corrected for negative non-integers
+        __m128 integer = _mm_cvtepi32_ps(_mm_cvttps_epi32(x));
+        integer = _mm_sub_ps(integer, _mm_and_ps(_mm_cmplt_ps(x, integer), _mm_set1_ps(1.0f)));
+        const __m128 t = _mm_sub_ps(x, integer);
+
+        __m128 p = _mm_set1_ps(exp2C5);
+        p = _mm_add_ps(_mm_mul_ps(p, t), _mm_set1_ps(exp2C4));
+        p = _mm_add_ps(_mm_mul_ps(p, t), _mm_set1_ps(exp2C3));
+        p = _mm_add_ps(_mm_mul_ps(p, t), _mm_set1_ps(exp2C2));
+        p = _mm_add_ps(_mm_mul_ps(p, t), _mm_set1_ps(exp2C1));
+        p = _mm_add_ps(_mm_mul_ps(p, t), _mm_set1_ps(exp2C0));
+
+        const __m128i scaleBits = _mm_slli_epi32(_mm_add_epi32(_mm_cvttps_epi32(integer), _mm_set1_epi32(127)), 23);
+        return _mm_mul_ps(p, _mm_castsi128_ps(scaleBits));
+    }
+
+    VECTOR_KERNELS_SSE2 void decibelsToGainSSE2(float* src, float offsetInDecibels, int numSamples)
+    {
+        const __m128 offset = _mm_set1_ps(offsetInDecibels);
+
+        int i = 0;
+        for (; i + 4 <= numSamples; i += 4)
+        {
+            const __m128 gainInDecibels = _mm_add_ps(_mm_loadu_ps(src + i), offset);
+            const __m128 audible = _mm_cmpgt_ps(gainInDecibels, _mm_set1_ps(minusInfinityDb));
+            const __m128 gain = fastExp2(_mm_mul_ps(gainInDecibels, _mm_set1_ps(octavesPerDb)));
+            _mm_storeu_ps(src + i, _mm_and_ps(audible, gain));
+        }
+
+        decibelsToGainScalar(src + i, offsetInDecibels, numSamples - i);
+    }
+
+    VECTOR_KERNELS_AVX2 inline __m256 fastLog2(__m256 x)
+    {
+        const __m256i bits = _mm256_castps_si256(x);
+        const __m256i biased = _mm256_and_si256(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(0xff));
+        const __m256 exponent = _mm256_cvtepi32_ps(_mm256_sub_epi32(biased, _mm256_set1_epi32(127)));
+        const __m256i mantissaBits = _mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi32(0x007fffff)),
+                                                     _mm256_set1_epi32(0x3f800000));
+        const __m256 t = _mm256_sub_ps(_mm256_castsi256_ps(mantissaBits), _mm256_set1_ps(1.0f));
+
+        __m256 p = _mm256_set1_ps(log2C5);
+        p = _mm256_fmadd_ps(p, t, _mm256_set1_ps(log2C4));
+        p = _mm256_fmadd_ps(p, t, _mm256_set1_ps(log2C3));
+        p = _mm256_fmadd_ps(p, t, _mm256_set1_ps(log2C2));
+        p = _mm256_fmadd_ps(p, t, _mm256_set1_ps(log2C1));
+        p = _mm256_fmadd_ps(p, t, _mm256_set1_ps(log2C0));
+        return _mm256_fmadd_ps(p, t, exponent);
+    }
+
+    VECTOR_KERNELS_AVX2 inline __m256 attenuation(__m256 in, __m256 threshold, __m256 kneeHalf, __m256 slope,
+                                                  __m256 kneeScale)
+    {
+        const __m256 signMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+        const __m256 level = _mm256_max_ps(_mm256_and_ps(in, signMask), _mm256_set1_ps(minLevel));
+        const __m256 levelInDecibels = _mm256_max_ps(_mm256_mul_ps(fastLog2(level), _mm256_set1_ps(dbPerOctave)),
+                                                     _mm256_set1_ps(minusInfinityDb));
+        const __m256 overshoot = _mm256_sub_ps(levelInDecibels, threshold);
+
+        const __m256 hard = _mm256_mul_ps(slope, overshoot);
+        const __m256 kneeOffset = _mm256_add_ps(overshoot, kneeHalf);
+        const __m256 soft = _mm256_mul_ps(_mm256_mul_ps(kneeScale, kneeOffset), kneeOffset);
+
+        const __m256 inKnee = _mm256_cmp_ps(overshoot, kneeHalf, _CMP_LE_OQ);
+        const __m256 below = _mm256_cmp_ps(overshoot, _mm256_sub_ps(_mm256_setzero_ps(), kneeHalf), _CMP_LE_OQ);
+        const __m256 result = _mm256_blendv_ps(hard, soft, inKnee);
+        return _mm256_andnot_ps(below, result);
+    }
+
+    VECTOR_KERNELS_AVX2 inline __m256 attenuationHardKnee(__m256 in, __m256 threshold, __m256 slope)
+    {
+        const __m256 signMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+        const __m256 level = _mm256_max_ps(_mm256_and_ps(in, signMask), _mm256_set1_ps(minLevel));
+        const __m256 levelInDecibels = _mm256_max_ps(_mm256_mul_ps(fastLog2(level), _mm256_set1_ps(dbPerOctave)),
+                                                     _mm256_set1_ps(minusInfinityDb));
+        const __m256 overshoot = _mm256_sub_ps(levelInDecibels, threshold);
+        const __m256 below = _mm256_cmp_ps(overshoot, _mm256_setzero_ps(), _CMP_LE_OQ);
+        return _mm256_andnot_ps(below, _mm256_mul_ps(slope, overshoot));
+    }
+
+    VECTOR_KERNELS_AVX2 void computeAttenuationAVX2(float* src, int numSamples, const GainCurve& c)
+    {
+        const __m256 threshold = _mm256_set1_ps(c.threshold);
+        const __m256 kneeHalf = _mm256_set1_ps(c.kneeHalf);
+        const __m256 slope = _mm256_set1_ps(c.slope);
+        const __m256 kneeScale = _mm256_set1_ps(c.kneeScale);
+
+        int i = 0;
+        for (; i + 8 <= numSamples; i += 8)
+            _mm256_storeu_ps(src + i, attenuation(_mm256_loadu_ps(src + i), threshold, kneeHalf, slope, kneeScale));
+
+        computeAttenuationSSE2(src + i, numSamples - i, c);
+    }
+
+    VECTOR_KERNELS_AVX2 void computeAttenuationHardKneeAVX2(float* src, int numSamples, const GainCurve& c)
+    {
+        const __m256 threshold = _mm256_set1_ps(c.threshold);
+        const __m256 slope = _mm256_set1_ps(c.slope);
+
+        int i = 0;
+        for (; i + 8 <= numSamples; i += 8)
+            _mm256_storeu_ps(src + i, attenuationHardKnee(_mm256_loadu_ps(src + i), threshold, slope));
+
+        computeAttenuationHardKneeSSE2(src + i, numSamples - i, c);
+    }
+
+    VECTOR_KERNELS_AVX2 void computeAttenuationLanesAVX2(float* frames, int numFrames, const LaneCurves& c)
+    {
+        // One register per frame, the curves stay in registers for the whole buffer
+        const __m256 threshold = _mm256_load_ps(c.threshold);
+        const __m256 kneeHalf = _mm256_load_ps(c.kneeHalf);
+        const __m256 slope = _mm256_load_ps(c.slope);
+        const __m256 kneeScale = _mm256_load_ps(c.kneeScale);
+
+        for (int i = 0; i < numFrames; ++i)
+        {
+            float* frame = frames + i * laneCount;
+            _mm256_storeu_ps(frame, attenuation(_mm256_loadu_ps(frame), threshold, kneeHalf, slope, kneeScale));
+        }
+    }
+
+    VECTOR_KERNELS_AVX2 inline __m256 fastExp2(__m256 x)
+    {
+        x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(-maxExponent)), _mm256_set1_ps(maxExponent));
+        const __m256 integer = _mm256_floor_ps(x);
+        const __m256 t = _mm256_sub_ps(x, integer);
+
+        __m256 p = _mm256_set1_ps(exp2C5);
+        p = _mm256_fmadd_ps(p, t, _mm256_set1_ps(exp2C4));
+        p = _mm256_fmadd_ps(p, t, _mm256_set1_ps(exp2C3));
+        p = _mm256_fmadd_ps(p, t, _mm256_set1_ps(exp2C2));
+        p = _mm256_fmadd_ps(p, t, _mm256_set1_ps(exp2C1));
+        p = _mm256_fmadd_ps(p, t, _mm256_set1_ps(exp2C0));
+
+        const __m256i scaleBits = _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvttps_epi32(integer),
+                                                                     _mm256_set1_epi32(127)), 23);
+        return _mm256_mul_ps(p, _mm256_castsi256_ps(scaleBits));
+    }
+
+    VECTOR_KERNELS_AVX2 void decibelsToGainAVX2(float* src, float offsetInDecibels, int numSamples)
+    {
+        const __m256 offset = _mm256_set1_ps(offsetInDecibels);
+
+        int i = 0;
+        for (; i + 8 <= numSamples; i += 8)
+        {
+            const __m256 gainInDecibels = _mm256_add_ps(_mm256_loadu_ps(src + i), offset);
+            const __m256 audible = _mm256_cmp_ps(gainInDecibels, _mm256_set1_ps(minusInfinityDb), _CMP_GT_OQ);
+            const __m256 gain = fastExp2(_mm256_mul_ps(gainInDecibels, _mm256_set1_ps(octavesPerDb)));
+            _mm256_storeu_ps(src + i, _mm256_and_ps(audible, gain));
+        }
+
+        decibelsToGainSSE2(src + i, offsetInDecibels, numSamples - i);
+    }
+#endif
+
+    //==============================================================================
+#if VECTOR_KERNELS_NEON
+    inline float32x4_t fastLog2(float32x4_t x)
+    {
+        const uint32x4_t bits = vreinterpretq_u32_f32(x);
+        const int32x4_t biased = vreinterpretq_s32_u32(vandq_u32(vshrq_n_u32(bits, 23), vdupq_n_u32(0xff)));
+        const float32x4_t exponent = vcvtq_f32_s32(vsubq_s32(biased, vdupq_n_s32(127)));
+        const uint32x4_t mantissaBits = vorrq_u32(vandq_u32(bits, vdupq_n_u32(0x007fffff)), vdupq_n_u32(0x3f800000));
+        const float32x4_t t = vsubq_f32(vreinterpretq_f32_u32(mantissaBits), vdupq_n_f32(1.0f));
+
+        float32x4_t p = vdupq_n_f32(log2C5);
+        p = vmlaq_f32(vdupq_n_f32(log2C4), p, t);
+        p = vmlaq_f32(vdupq_n_f32(log2C3), p, t);
+        p = vmlaq_f32(vdupq_n_f32(log2C2), p, t);
+        p = vmlaq_f32(vdupq_n_f32(log2C1), p, t);
+        p = vmlaq_f32(vdupq_n_f32(log2C0), p, t);
+        return vmlaq_f32(exponent, p, t);
+    }
+
+    inline float32x4_t attenuation(float32x4_t in, float32x4_t threshold, float32x4_t kneeHalf, float32x4_t slope,
+                                   float32x4_t kneeScale)
+    {
+        const float32x4_t level = vmaxq_f32(vabsq_f32(in), vdupq_n_f32(minLevel));
+        const float32x4_t levelInDecibels = vmaxq_f32(vmulq_n_f32(fastLog2(level), dbPerOctave),
+                                                      vdupq_n_f32(minusInfinityDb));
+        const float32x4_t overshoot = vsubq_f32(levelInDecibels, threshold);
+
+        const float32x4_t hard = vmulq_f32(slope, overshoot);
+        const float32x4_t kneeOffset = vaddq_f32(overshoot, kneeHalf);
+        const float32x4_t soft = vmulq_f32(vmulq_f32(kneeScale, kneeOffset), kneeOffset);
+
+        const uint32x4_t inKnee = vcleq_f32(overshoot, kneeHalf);
+        const uint32x4_t below = vcleq_f32(overshoot, vnegq_f32(kneeHalf));
+        const float32x4_t result = vbslq_f32(inKnee, soft, hard);
+        return vreinterpretq_f32_u32(vbicq_u32(vreinterpretq_u32_f32(result), below));
+    }
+
+    inline float32x4_t attenuationHardKnee(float32x4_t in, float32x4_t threshold, float32x4_t slope)
+    {
+        const float32x4_t level = vmaxq_f32(vabsq_f32(in), vdupq_n_f32(minLevel));
+        const float32x4_t levelInDecibels = vmaxq_f32(vmulq_n_f32(fastLog2(level), dbPerOctave),
+                                                      vdupq_n_f32(minusInfinityDb));
+        const float32x4_t overshoot = vsubq_f32(levelInDecibels, threshold);
+        const uint32x4_t below = vcleq_f32(overshoot, vdupq_n_f32(0.0f));
+        return vreinterpretq_f32_u32(vbicq_u32(vreinterpretq_u32_f32(vmulq_f32(slope, overshoot)), below));
+    }
+
+    void computeAttenuationNEON(float* src, int numSamples, const GainCurve& c)
+    {
+        const float32x4_t threshold = vdupq_n_f32(c.threshold);
+        const float32x4_t kneeHalf = vdupq_n_f32(c.kneeHalf);
+        const float32x4_t slope = vdupq_n_f32(c.slope);
+        const float32x4_t kneeScale = vdupq_n_f32(c.kneeScale);
+
+        int i = 0;
+        for (; i + 4 <= numSamples; i += 4)
+            vst1q_f32(src + i, attenuation(vld1q_f32(src + i), threshold, kneeHalf, slope, kneeScale));
+
+        computeAttenuationScalar(src + i, numSamples - i, c);
+    }
+
+    void computeAttenuationHardKneeNEON(float* src, int numSamples, const GainCurve& c)
+    {
+        const float32x4_t threshold = vdupq_n_f32(c.threshold);
+        const float32x4_t slope = vdupq_n_f32(c.slope);
+
+        int i = 0;
+        for (; i + 4 <= numSamples; i += 4)
+            vst1q_f32(src + i, attenuationHardKnee(vld1q_f32(src + i), threshold, slope));
+
+        computeAttenuationHardKneeScalar(src + i, numSamples - i, c);
+    }
+
+    void computeAttenuationLanesNEON(float* frames, int numFrames, const LaneCurves& c)
+    {
+        const float32x4_t thresholdLow = vld1q_f32(c.threshold), thresholdHigh = vld1q_f32(c.threshold + 4);
+        const float32x4_t kneeHalfLow = vld1q_f32(c.kneeHalf), kneeHalfHigh = vld1q_f32(c.kneeHalf + 4);
+        const float32x4_t slopeLow = vld1q_f32(c.slope), slopeHigh = vld1q_f32(c.slope + 4);
+        const float32x4_t kneeScaleLow = vld1q_f32(c.kneeScale), kneeScaleHigh = vld1q_f32(c.kneeScale + 4);
+
+        for (int i = 0; i < numFrames; ++i)
+        {
+            float* frame = frames + i * laneCount;
+            vst1q_f32(frame, attenuation(vld1q_f32(frame), thresholdLow, kneeHalfLow, slopeLow, kneeScaleLow));
+            vst1q_f32(frame + 4, attenuation(vld1q_f32(frame + 4), thresholdHigh, kneeHalfHigh, slopeHigh,
+                                             kneeScaleHigh));
+        }
+    }
+
+    inline float32x4_t fastExp2(float32x4_t x)
+    {
+        x = vminq_f32(vmaxq_f32(x, vdupq_n_f32(-maxExponent)), vdupq_n_f32(maxExponent));
+
+        float32x4_t integer = vcvtq_f32_s32(vcvtq_s32_f32(x));
+        const uint32x4_t roundedUp = vcltq_f32(x, integer);
+        integer = vsubq_f32(integer, vreinterpretq_f32_u32(vandq_u32(roundedUp, vreinterpretq_u32_f32(vdupq_n_f32(1.0f)))));
+        const float32x4_t t = vsubq_f32(x, integer);
+
+        float32x4_t p = vdupq_n_f32(exp2C5);
+        p = vmlaq_f32(vdupq_n_f32(exp2C4), p, t);
+        p = vmlaq_f32(vdupq_n_f32(exp2C3), p, t);
+        p = vmlaq_f32(vdupq_n_f32(exp2C2), p, t);
+        p = vmlaq_f32(vdupq_n_f32(exp2C1), p, t);
+        p = vmlaq_f32(vdupq_n_f32(exp2C0), p, t);
+
+        const int32x4_t scaleBits = vshlq_n_s32(vaddq_s32(vcvtq_s32_f32(integer), vdupq_n_s32(127)), 23);
+        return vmulq_f32(p, vreinterpretq_f32_s32(scaleBits));
+    }
+
+    void decibelsToGainNEON(float* src, float offsetInDecibels, int numSamples)
+    {
+        const float32x4_t offset = vdupq_n_f32(offsetInDecibels);
+
+        int i = 0;
+        for (; i + 4 <= numSamples; i += 4)
+        {
+            const float32x4_t gainInDecibels = vaddq_f32(vld1q_f32(src + i), offset);
+            const uint32x4_t audible = vcgtq_f32(gainInDecibels, vdupq_n_f32(minusInfinityDb));
+            const float32x4_t gain = fastExp2(vmulq_n_f32(gainInDecibels, octavesPerDb));
+            vst1q_f32(src + i, vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(gain), audible)));
+        }
+
+        decibelsToGainScalar(src + i, offsetInDecibels, numSamples - i);
+    }
+#endif
+
+    //==============================================================================
+    struct Dispatch
+    {
+        void (*computeAttenuation)(float*, int, const GainCurve&);
+        void (*computeAttenuationHardKnee)(float*, int, const GainCurve&);
+        void (*computeAttenuationLanes)(float*, int, const LaneCurves&);
+        void (*decibelsToGain)(float*, float, int);
+        const char* name;
+    };
+
+    Dispatch selectDispatch()
+    {
+#if JUCE_INTEL
+        if (SystemStats::hasAVX2() && SystemStats::hasFMA3())
+            return {computeAttenuationAVX2, computeAttenuationHardKneeAVX2, computeAttenuationLanesAVX2,
+                    decibelsToGainAVX2, "AVX2"};
+        if (SystemStats::hasSSE2())
+            return {computeAttenuationSSE2, computeAttenuationHardKneeSSE2, computeAttenuationLanesSSE2,
+                    decibelsToGainSSE2, "SSE2"};
+#elif VECTOR_KERNELS_NEON
+        return {computeAttenuationNEON, computeAttenuationHardKneeNEON, computeAttenuationLanesNEON,
+                decibelsToGainNEON, "NEON"};
+#endif
+        return {computeAttenuationScalar, computeAttenuationHardKneeScalar, computeAttenuationLanesScalar,
+                decibelsToGainScalar, "Scalar"};
+    }
+
+    const Dispatch& getDispatch()
+    {
+        static const Dispatch dispatch = selectDispatch();
+        return dispatch;
+    }
+}
+
+void computeAttenuation(float* src, int numSamples, const GainCurve& curve)
+{
+    getDispatch().computeAttenuation(src, numSamples, curve);
+}
+
+void computeAttenuationHardKnee(float* src, int numSamples, const GainCurve& curve)
+{
+    jassert(curve.kneeHalf == 0.0f);
+    getDispatch().computeAttenuationHardKnee(src, numSamples, curve);
+}
+
+void computeAttenuationLanes(float* frames, int numFrames, const LaneCurves& curves)
+{
+    getDispatch().computeAttenuationLanes(frames, numFrames, curves);
+}
+
+void decibelsToGain(float* src, float offsetInDecibels, int numSamples)
+{
+    getDispatch().decibelsToGain(src, offsetInDecibels, numSamples);
+}
+
+void decibelsToGainExact(float* src, float offsetInDecibels, int numSamples)
+{
+    for (int i = 0; i < numSamples; ++i)
+        src[i] = Decibels::decibelsToGain(src[i] + offsetInDecibels);
+}
+
+const char* getInstructionSetName()
+{
+    return getDispatch().name;
+}
+}
@@ -0,0 +1,59 @@
+/*
+  ==============================================================================
+    File:           BlockBiquad.h
+    Developers:     D. Robert Hoover and Kris Keillor
+    Repository URL: https://github.com/Top-Notch-DSP/GlobeLoveler
+    Date:           2024 Feb 1
+    License:        GNU General Public License, version 3.0 (GPL-3.0)
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+/* BlockBiquad:
+ * One biquad section in a block state-space form, shared by the side-chain filter and the crossovers.
+ * Sub-blocks of blockSize samples are processed at once: the feed-forward half and the zero-state
+ * response of the feedback within every group of four samples are vector multiply-adds over the
+ * sub-block. Only the state carried from group to group stays serial, one multiply-add deep
+ * per four samples instead of two per sample.
+ * Designs follow the RBJ audio EQ cookbook.
+ */
+class BlockBiquad
+{
+public:
+    static constexpr int blockSize = 64;
+    // Unrolled by hand in processBlock
+    static constexpr int groupSize = 4;
+
+    struct Coefficients
+    {
+        float b0{1.0f}, b1{0.0f}, b2{0.0f}, a1{0.0f}, a2{0.0f};
+
+        // Feedback impulse response h[j] for lane k >= j of every group, 0 otherwise
+        alignas(32) float impulse[groupSize][blockSize]{};
+        // Lane k's response to the last two outputs before its group
+        float fromY1[groupSize]{};
+        float fromY2[groupSize]{};
+    };
+
+    // Direct form I, the input history feeds the vectorised feed-forward half
+    struct State
+    {
+        float x1{0.0f}, x2{0.0f}, y1{0.0f}, y2{0.0f};
+    };
+
+    // Normalises by a0 and derives the block form
+    static Coefficients make(double b0, double b1, double b2, double a0, double a1, double a2);
+
+    static Coefficients lowPass(double sampleRate, double frequency, double q);
+    static Coefficients highPass(double sampleRate, double frequency, double q);
+    static Coefficients allPass(double sampleRate, double frequency, double q);
+
+    // Filters numSamples in place
+    static void process(const Coefficients&, State&, float* data, int numSamples);
+
+private:
+    static void processBlock(const Coefficients&, State&, float* data, int numSamples);
+};
@@ -0,0 +1,53 @@
+/*
+  ==============================================================================
+    File:           CoefficientTable.h
+    Developers:     D. Robert Hoover and Kris Keillor
+    Repository URL: https://github.com/Top-Notch-DSP/GlobeLoveler
+    Date:           2024 Feb 1
+    License:        GNU General Public License, version 3.0 (GPL-3.0)
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <array>
+#include <cmath>
+
+/* CoefficientTable:
+ * One-pole coefficients e^(-1/(T*fs)) of the ballistics and smoothing classes without exp().
+ * The coefficient only depends on x = 1/(T*fs), so a single table over x serves every sample rate and
+ * all instances share it read-only. It holds (1 - e^(-x)) / x, which is smooth and close to 1, so linear
+ * interpolation keeps 1 - coefficient, and with it the time constant, accurate to about 1e-7 however slow.
+ * Time constants shorter than one sample fall back to exp().
+ */
+class CoefficientTable
+{
+public:
+    static constexpr int size = 1024;
+
+    // Returns the shared table, built on the first call. Call from prepare, so the audio thread never builds it
+    static const CoefficientTable& getInstance();
+
+    // e^(-1/(T*fs)) for a time constant T in seconds
+    double getCoefficient(double timeInSeconds, double sampleRate) const;
+
+    // e^(-x) for x = 1/(T*fs), the reciprocal time constant in samples. Inline for per-sample use
+    double getDecay(double x) const;
+
+private:
+    CoefficientTable();
+
+    // (1 - e^(-x)) / x at x = i / size, one guard entry for interpolation at x = 1
+    std::array<double, size + 2> values{};
+};
+
+inline double CoefficientTable::getDecay(double x) const
+{
+    if (!(x >= 0.0 && x <= 1.0))
+        return std::exp(-x);
+
+    const double position = x * size;
+    const int index = static_cast<int>(position);
+    const double fraction = position - index;
+    return 1.0 - x * (values[index] + fraction * (values[index + 1] - values[index]));
+}
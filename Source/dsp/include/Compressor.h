@@ -18,22 +18,53 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #pragma once
 #include "LevelDetector.h"
 #include "GainComputer.h"
+#include "DelayLine.h"
+#include "SidechainFilter.h"
+#include "MultibandCompressor.h"
 #include "../JuceLibraryCode/JuceHeader.h"
 
 /* Compressor-Class:
  * The circruit is modeled after the "ideal" VCA-Compressor
  * based on the paper "Digital Dynamic Range Compressor Design �  Tutorial and Analysis"
  * by Giannoulis, Massberg & Reiss
+ * While no parameter ramps, mono and peak-linked stereo run through processRangeCore, instantiated per knee type,
+ * detector topology, channel count and mix. selectRangeProcessor picks the instantiation for every block,
+ * anything it doesn't cover takes the generic processRange. Both produce bit-identical output.
  */
 
 class Compressor
 {
 public:
+    // Processing engines, both produce bit-identical output
+    enum class Engine
+    {
+        multiPass, // One sweep over the whole block per stage
+        fused      // All stages per sub-block of fusedBlockSize samples, stays in L1 cache
+    };
+
+    // How the side-chain is derived from the input channels
+    enum class DetectionMode
+    {
+        maxLinked, // Peak of all channels drives one gain
+        rmsLinked, // RMS across all channels drives one gain
+        unlinked,  // Every channel is compressed on its own
+        grouped    // Peak within groups set by setChannelGroups, e.g. L/R + C + LFE + surrounds
+    };
+
+    // Sub-block length of the fused engine, multiple of the widest SIMD kernel
+    static constexpr int fusedBlockSize = 64;
+
+    // Longest lookahead setLookahead accepts
+    static constexpr float maxLookaheadInMs = 10.0f;
+
+    // Largest factor setOversampling accepts
+    static constexpr int maxOversamplingFactor = 8;
 
     Compressor() = default;
     ~Compressor();
 
     // Prepares compressor with a ProcessSpec-Object containing samplerate, blocksize and number of channels
+    // Side-chain buffers and detectors for every channel are allocated here, never while processing
     void prepare(const dsp::ProcessSpec& ps);
 
     // Sets compressor to bypassed/not bypassed
@@ -63,6 +94,59 @@ public:
     // Sets release time in milliseconds
     void setRelease(float);
 
+    // Derives attack and release per sample from the crest factor of the side-chain level, see LevelDetector.
+    // The attack and release settings then hold for a sine's crest factor
+    void setAutoAttack(bool);
+    void setAutoRelease(bool);
+
+    // Selects the detector: peak (branched or decoupled), sliding-window RMS of the side-chain level or the mean
+    // of peak and RMS, both smoothed like the branched peak after the gain computer.
+    // Applies to every band in multiband mode
+    void setDetectorTopology(LevelDetector::Topology);
+
+    // Sets lookahead in milliseconds, 0 to maxLookaheadInMs. The side-chain sees the input this much
+    // earlier than the gain is applied, the audio path is delayed by getLatencySamples()
+    void setLookahead(float);
+
+    // Runs detection and gain at 1, 2, 4 or 8 times the sample rate between half-band filters,
+    // linear phase (FIR equiripple) or minimum phase (polyphase IIR). Every variant is allocated in prepare,
+    // switching only resets filter, detector and lookahead state
+    void setOversampling(int factor, bool linearPhase);
+
+    // Sets the side-chain high-pass cutoff in Hz, 0 switches it off
+    void setSidechainHighPass(float);
+
+    // Sets the side-chain tilt in dB from lows to highs around SidechainFilter::tiltPivotInHz
+    void setSidechainTilt(float);
+
+    // Splits into 3 to 5 bands compressed by MultibandCompressor with the same characteristics, 1 is single-band.
+    // Bands detect from their own signal, the external key, side-chain filter, detection mode and parameter ramps
+    // only apply to the single-band path
+    void setNumBands(int);
+
+    // Sets the lowest and highest crossover frequency in Hz
+    void setCrossovers(float lowInHz, float highInHz);
+
+    // Splits large blocks of the multiband mode on one thread per band, for offline rendering only
+    void setParallelBands(bool);
+
+    // Sets the ramp time of threshold, ratio, knee, makeup and mix in milliseconds
+    // Ramps run per sample in the fused loop, a session without parameter changes never touches them
+    void setSmoothingTime(float);
+
+    // Uses the exact scalar reference paths instead of the approximated SIMD kernels
+    void setExactMode(bool);
+
+    // Selects the processing engine
+    void setEngine(Engine);
+
+    // Selects how channels are linked for detection
+    void setDetectionMode(DetectionMode);
+
+    // Sets the group id of each channel for DetectionMode::grouped, missing channels go to group 0
+    // Allocates, call from the message thread
+    void setChannelGroups(const std::vector<int>& groups);
+
     // Gets current make-up gain value
     float getMakeup();
 
@@ -71,26 +155,113 @@ public:
 
     float getMaxGainReduction();
 
-    // Processes input buffer
+    // Delay of the audio path caused by lookahead and oversampling filters, in samples at the prepared sample rate
+    int getLatencySamples() const;
+
+    // Returns how many samples the ballistics need until two runs that started from different
+    // states differ by less than maxErrorInDecibels, assuming attenuation stays within maxAttenuationInDecibels.
+    // The detector contracts at least by the slower of the attack and release coefficients per sample,
+    // auto mode also by the crest statistics, the RMS window adds its length. In multiband mode the slowest band counts
+    int64 getSettlingSamples(float maxErrorInDecibels, float maxAttenuationInDecibels = 100.0f) const;
+
+    // Processes input buffer, up to the number of channels given in prepare()
     void process(AudioBuffer<float>& buffer);
 
+    // Same, with detection driven by an external key instead of the input. Key channels are used round-robin,
+    // a mono key drives every channel. Up to the number of channels given in prepare(), input gain isn't applied
+    void process(AudioBuffer<float>& buffer, const AudioBuffer<float>& sidechainInput);
+
 private:
+    void processWithKey(AudioBuffer<float>&, const float* const* key, int numKeyChannels);
+    void processAtProcessingRate(AudioBuffer<float>&);
+    void prepareProcessingRate();
+    double getProcessingRate() const;
+    int getLookaheadSamples() const;
     inline void applyInputGain(AudioBuffer<float>&, int);
+    inline void applyMixToGain(float*, int);
+    void processMultiPass(AudioBuffer<float>&);
+    void processFused(AudioBuffer<float>&);
+    void processMultiband(AudioBuffer<float>&);
+    float processRange(float* const*, int, int, int, float*, int);
+
+    using RangeProcessor = float (Compressor::*)(float* const*, int, int, int, float*, int);
+    RangeProcessor selectRangeProcessor(int numChannels) const;
+    template <bool hardKnee, LevelDetector::Topology>
+    RangeProcessor selectRangeCore(int numChannels) const;
+
+    // processRange for one group of numCoreChannels peak-linked channels and parameters that don't ramp.
+    // Everything a block could switch is a template argument, the sample loops carry no branches
+    template <bool hardKnee, LevelDetector::Topology, int numCoreChannels, bool mixActive>
+    float processRangeCore(float* const*, int, int, int, float*, int);
+
+    const float* const* getDetectionSource(float* const* channels, int numChannels, int start, int numSamples,
+                                           int& numSources, int& sourceStart);
+    inline void computeAttenuation(float*, int);
+    inline void applyBallistics(int, float*, int);
+    inline void decibelsToGain(float*, float, int);
+    bool isSmoothing() const;
+    void resetSmoothers();
+    void updateGroups(int numChannels);
 
     //Directly initialize process spec to avoid debugging problems
     juce::dsp::ProcessSpec procSpec{-1, 0, 0};
 
-    AudioBuffer<float> originalSignal;
     std::vector<float> sidechainSignal;
     float* rawSidechainSignal{nullptr};
+    int sidechainStride{0};
+    std::vector<float> fusedSidechainSignal;
+
+    // Detection source of the current block at the processing rate, nullptr for the input itself
+    const float* const* keyChannels{nullptr};
+    int numKeyChannels{0};
+    SidechainFilter sidechainFilter;
+    std::vector<float> filteredKeySignal;
+    std::vector<float*> filteredKeyChannels;
+
+    std::vector<LevelDetector> ballistics;
+    DelayLine lookaheadDelay;
 
-    LevelDetector ballistics;
+    // [linear phase][log2(factor) - 1], the active one or nullptr when not oversampling
+    std::unique_ptr<dsp::Oversampling<float>> oversamplers[2][3];
+    dsp::Oversampling<float>* oversampler{nullptr};
+    std::vector<const float*> upsamplingInput;
+    std::vector<float*> oversampledChannels;
+    int oversamplingFactor{1};
+    bool linearPhaseOversampling{true};
     GainComputer gainComputer;
+    MultibandCompressor multiband;
+    int numBands{1};
+
+    DetectionMode detectionMode{DetectionMode::maxLinked};
+    std::vector<int> customGroups;
+    std::vector<int> channelGroup;
+    std::vector<int> groupId;
+    std::vector<int> groupSize;
+    std::vector<int> groupFirstChannel;
+    int numGroups{0};
+    // Channels the groups were derived from, those of the last block
+    int numGroupedChannels{0};
+
+    SmoothedValue<float> thresholdSmoother{-20.0f};
+    SmoothedValue<float> ratioSmoother{2.0f};
+    SmoothedValue<float> kneeSmoother{6.0f};
+    SmoothedValue<float> makeupSmoother{0.0f};
+    SmoothedValue<float> mixSmoother{1.0f};
+    double smoothingTimeInSeconds{0.05};
+    float lookaheadInMs{0.0f};
+
+    double attackTimeInSeconds{0.01};
+    double releaseTimeInSeconds{0.14};
+    bool autoAttack{false};
+    bool autoRelease{false};
+    LevelDetector::Topology detectorTopology{LevelDetector::Topology::branchedPeak};
 
     float input{0.0f};
     float prevInput{0.0f};
     float makeup{0.0f};
     bool bypassed{false};
+    bool exactMode{false};
+    Engine engine{Engine::multiPass};
     float mix{1.0f};
     float maxGainReduction{0.0f};
 };
@@ -0,0 +1,45 @@
+/*
+  ==============================================================================
+    File:           DelayLine.h
+    Developers:     D. Robert Hoover and Kris Keillor
+    Repository URL: https://github.com/Top-Notch-DSP/GlobeLoveler
+    Date:           2024 Feb 1
+    License:        GNU General Public License, version 3.0 (GPL-3.0)
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <vector>
+
+/* DelayLine:
+ * Fixed integer delay for several channels, used to hold back the audio path while the side-chain looks ahead.
+ * Memory for the longest delay is allocated in prepare, changing the delay while processing never allocates.
+ * Samples are swapped in place between the block and a circular buffer of exactly the delay length.
+ */
+class DelayLine
+{
+public:
+    DelayLine() = default;
+
+    // Allocates storage for numChannels and delays up to maxDelayInSamples
+    void prepare(int numChannels, int maxDelayInSamples);
+
+    // Sets the delay, clamped to the maximum from prepare. Clears the line when the delay changes
+    void setDelay(int delayInSamples);
+
+    int getDelay() const;
+
+    // Clears the stored samples
+    void reset();
+
+    // Delays numSamples of every channel in place, starting at sample start
+    void process(float* const* channels, int numChannels, int start, int numSamples);
+
+private:
+    std::vector<float> storage;
+    int capacity{0};
+    int numChannelsPrepared{0};
+    int delay{0};
+    int position{0};
+};
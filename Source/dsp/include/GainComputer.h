@@ -16,6 +16,7 @@ You should have received a copy of the GNU General Public License
 along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 #pragma once
+#include "VectorKernels.h"
 
 /* GainComputer Class:
  * Calculates the needed attenuation to compress a signal with given characteristics
@@ -39,8 +40,21 @@ public:
     // returns attenuation
     float applyCompression(float&);
 
+    // Converts a linear buffer in-place to attenuation in dB using the SIMD kernels
     void applyCompressionToBuffer(float*, int);
 
+    // applyCompressionToBuffer without the knee segment, only while isHardKnee()
+    void applyHardKneeCompressionToBuffer(float*, int);
+
+    // True while the knee-width is 0
+    bool isHardKnee() const;
+
+    // Scalar reference for applyCompressionToBuffer, exact Decibels::gainToDecibels per sample
+    void applyCompressionToBufferReference(float*, int);
+
+    // Gets the current characteristics as consumed by VectorKernels
+    VectorKernels::GainCurve getCurve() const;
+
 private:
     float threshold{-20.0f};
     float ratio{2.0f};
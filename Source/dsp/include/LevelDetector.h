@@ -16,7 +16,9 @@ You should have received a copy of the GNU General Public License
 along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 #pragma once
+#include <vector>
 #include "SmoothingFilter.h"
+#include "CoefficientTable.h"
 
 
 /*LevelDetector Class:
@@ -24,15 +26,50 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
  * Might be used in linear or log. domain
  * In this compressor implementation it's used in log. domain after the gain computer to smooth the calculated attenuations,
  * therefore the detector does not have to work on the whole dynamic range of the input signal
+ * applyBallistics runs the branched detector with only the attack steps on the serial path:
+ * a release run is linear, so every release sample follows in closed form from where the run started.
+ * The topology picks the level the gain computer sees and how its attenuation is smoothed. applyLevel turns the
+ * linear side-chain into its RMS over a sliding window, or the mean of peak and RMS, before the gain computer.
+ * Their attenuation goes through the branched detector like the peak's, the decoupled peak detector has its own.
+ * Auto attack and release follow the crest factor of the linear level, which applyLevel measures on its way.
+ * Each topology is a policy the per-sample loop is instantiated with, selected once per buffer.
  */
 class LevelDetector
 {
 public:
+    enum class Topology
+    {
+        branchedPeak = 0,
+        decoupledPeak,
+        rms,
+        hybrid
+    };
+
+    // Time constant of the running peak and RMS statistics behind the crest factor in auto mode
+    static constexpr double crestTimeInSeconds = 0.2;
+
+    // Length of the sliding window of the RMS and hybrid topologies
+    static constexpr double rmsWindowInSeconds = 0.01;
+
+    // Samples per zero-state release response in applyBallistics, every group restarts the release run
+    static constexpr int groupSize = 8;
+
     LevelDetector() = default;
 
     // Prepares LevelDetector with a ProcessSpec-Object containing samplerate, blocksize and number of channels
     void prepare(const double& fs);
 
+    // Allocates the RMS window for sample rates up to maxSampleRate, so prepare never allocates below it
+    void setMaximumSampleRate(double);
+
+    // Allocates the crest factors auto mode keeps between applyLevel and applyBallistics, call before processing
+    void setMaximumBlockSize(int);
+
+    // Selects the detector topology, clears the RMS window when switching to one that uses it
+    void setTopology(Topology);
+
+    Topology getTopology() const;
+
     // Sets attack time constant
     void setAttack(const double&);
 
@@ -51,20 +88,91 @@ public:
     // gets calculated release coefficient
     double getAlphaRelease();
 
+    // Program-dependent attack: the attack time becomes 2 * attack / crest^2, with the crest factor of the linear
+    // side-chain level applyLevel was given. The set attack holds at a sine's crest factor,
+    // transients attack faster, dense material slower
+    void setAutoAttack(bool);
+
+    // Program-dependent release: the release time becomes 2 * release / crest^2 - attack time,
+    // short after transients and long after a sustained level
+    void setAutoRelease(bool);
+
+    // True if either time constant follows the program
+    bool isAutomatic() const;
+
+    // Seconds until two runs that started from different states differ by e^-decay of their initial difference.
+    // Program-dependent times reach twice the set ones at a crest factor of 1 and follow the crest statistics,
+    // so auto mode waits for those as well. The decoupled detector chains both filters, the RMS window adds its length
+    double getSettlingTime(double decay) const;
+
     // Processes a sample with smooth branched peak detector
     float processPeakBranched(const float&);
 
     // Processes a sample with smooth decoupled peak detector
     float processPeakDecoupled(const float&);
 
-    // Applies ballistics to given buffer
+    // Processes a sample with the branched peak detector, coefficients derived from the squared crest factor
+    // of the level the sample was computed from. The coefficients come from a lookup table
+    float processPeakAuto(const float&, float crestSquare);
+
+    // RMS of the linear level over the last rmsWindowInSeconds.
+    // A running sum of squares, summed afresh once per window length so its rounding drift stays bounded
+    float processRmsWindow(const float&);
+
+    // Replaces the linear side-chain level by what the gain computer of the current topology sees:
+    // the sliding-window RMS, the mean of peak and RMS, or the peak itself.
+    // In auto mode it also measures the crest factor the next applyBallistics of as many samples uses
+    void applyLevel(float*, int);
+
+    // applyLevel for the topology known at compile time, which must be the selected one.
+    // Instantiated for every topology
+    template <Topology>
+    void applyLevel(float*, int);
+
+    // Applies the detector of the current topology to the attenuation in given buffer. With fixed time constants
+    // the branched detector runs speculatively, release runs in closed form. Auto attack and release apply to
+    // every topology but the decoupled peak detector
     void applyBallistics(float*, int);
 
+    // applyBallistics for the topology known at compile time, which must be the selected one.
+    // Instantiated for every topology
+    template <Topology>
+    void applyBallistics(float*, int);
+
+    // Scalar reference for applyBallistics, the branched detector per sample
+    void applyBallisticsReference(float*, int);
+
 private:
+    // Runs Detector::process(LevelDetector&, float) on every sample
+    template <typename Detector>
+    void applyDetector(float*, int);
+
+    // Running peak and mean square statistics of the linear level, one crest factor^2 per sample
+    void measureCrest(const float*, int);
+    void applyAutoPeak(float*, int);
+    void applyBranchedSpeculative(float*, int);
+    void updateReleasePowers();
+    void resetRmsWindow();
+
     double attackTimeInSeconds{0.01}, alphaAttack{0.0};
     double releaseTimeInSeconds{0.14}, alphaRelease{0.0};
     double state01{0.0}, state02{0.0};
+    double alphaCrest{0.0}, peakSquare{0.0}, meanSquare{0.0};
     double sampleRate{0.0};
+    // Squared crest factor of every sample of the last applyLevel in auto mode
+    std::vector<float> crestSquares;
+    int numCrestSamples{0};
+    // Shared by every detector, built when the first one is constructed
+    const CoefficientTable* coefficientTable{&CoefficientTable::getInstance()};
     bool autoAttack{false};
     bool autoRelease{false};
+    // alphaRelease^k for k = 0 to groupSize
+    double releasePowers[groupSize + 1]{};
+
+    Topology topology{Topology::branchedPeak};
+    // Squares of the last rmsLength inputs, rmsSum runs alongside
+    std::vector<float> rmsSquares;
+    int rmsLength{1};
+    int rmsIndex{0};
+    double rmsSum{0.0};
 };
@@ -0,0 +1,155 @@
+/*
+  ==============================================================================
+    File:           MultibandCompressor.h
+    Developers:     D. Robert Hoover and Kris Keillor
+    Repository URL: https://github.com/Top-Notch-DSP/GlobeLoveler
+    Date:           2024 Feb 1
+    License:        GNU General Public License, version 3.0 (GPL-3.0)
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "BlockBiquad.h"
+#include "DelayLine.h"
+#include "GainComputer.h"
+#include "LevelDetector.h"
+
+/* MultibandCompressor:
+ * Splits the signal into 3 to 5 bands with 4th order Linkwitz-Riley crossovers and compresses every band
+ * with its own GainComputer and LevelDetector, linked across channels by peak.
+ * The crossovers form a tree: band k is the low-pass of what the crossovers below k left over, followed by
+ * the all-passes of every crossover above k, so the bands sum back to an all-pass of the input.
+ * Each band's level, its peak or the RMS of the band's topology, is interleaved into frames of
+ * VectorKernels::laneCount bands for detection, one gain curve per lane,
+ * so the gain computers of all bands share one SIMD pass. Ballistics and gain conversion then run band by band.
+ * The compressed bands are summed into the channels.
+ * Everything is allocated in prepare, processing never allocates unless setParallelProcessing is on.
+ */
+class MultibandCompressor
+{
+public:
+    static constexpr int minBands = 3;
+    static constexpr int maxBands = 5;
+
+    // Shortest block the parallel mode hands to the worker threads, shorter ones are split on the calling thread
+    static constexpr int minParallelBlockSize = 4096;
+
+    // Samples per detection pass, the interleaved frames stay in L1 cache
+    static constexpr int detectionBlockSize = 64;
+
+    MultibandCompressor() = default;
+    ~MultibandCompressor();
+
+    // Allocates band buffers, filter state and lookahead for numChannels and blocks up to maxBlockSize samples
+    void prepare(double sampleRate, int numChannels, int maxBlockSize, int maxDelayInSamples);
+
+    // Recomputes the crossovers and detectors for another rate and clears all state, never allocates
+    void setSampleRate(double sampleRate);
+
+    // Sets the number of bands, minBands to maxBands. Clears the state when it changes
+    void setNumBands(int);
+
+    int getNumBands() const;
+
+    // LevelDetector::getSettlingTime of the slowest active band
+    double getSettlingTime(double decay) const;
+
+    // Sets the lowest and highest crossover in Hz, the ones between are spaced evenly in log frequency
+    void setCrossovers(float lowInHz, float highInHz);
+
+    // Per-band characteristics, same units as Compressor
+    void setThreshold(int band, float);
+    void setRatio(int band, float);
+    void setKnee(int band, float);
+    void setMakeup(int band, float);
+    void setAttack(int band, float);
+    void setRelease(int band, float);
+    void setAutoAttack(int band, bool);
+    void setAutoRelease(int band, bool);
+    void setTopology(int band, LevelDetector::Topology);
+
+    // Allocates the detectors' RMS windows up to maxSampleRate, call before prepare
+    void setMaximumSampleRate(double);
+
+    // Dry/wet mix of the whole compressor, 0.0f - 1.0f
+    void setMix(float);
+
+    // Delays the bands behind the detection by this many samples at the current rate
+    void setLookahead(int delayInSamples);
+
+    // Uses the exact scalar reference paths instead of the approximated SIMD kernels
+    void setExactMode(bool);
+
+    // Splits blocks of at least minParallelBlockSize on one thread per band. Output is bit-identical to
+    // the serial tree. Meant for offline rendering: the calling thread waits on a condition variable.
+    // Starts or stops the threads, call from the message thread
+    void setParallelProcessing(bool);
+
+    // Clears filter, detector and delay state
+    void reset();
+
+    // Compresses numSamples of every channel in place, returns the largest gain reduction of any band in dB
+    float process(float* const* channels, int numChannels, int numSamples);
+
+private:
+    // Filter state of one band of one channel: the high-passes of the crossovers below, the band's
+    // low-pass and the all-passes of the crossovers above, two sections for every LR4 filter
+    struct ChainState
+    {
+        BlockBiquad::State highPass[maxBands - 1][2];
+        BlockBiquad::State lowPass[2];
+        BlockBiquad::State allPass[maxBands - 1];
+    };
+
+    void updateCrossovers();
+    void splitTree(const float* const* channels, int numChannels, int numSamples);
+    void splitBand(int band, const float* const* channels, int numChannels, int numSamples);
+    void splitParallel(const float* const* channels, int numChannels, int numSamples);
+    float compressRange(float* const* channels, int numChannels, int start, int numSamples);
+    void stopWorkers();
+    void runWorker(int seenGeneration);
+    void runSplitTasks();
+    ChainState& getChain(int band, int channel);
+    float* getBand(int band, int channel);
+
+    double sampleRate{44100.0};
+    int numChannelsPrepared{0};
+    int bandStride{0};
+    int numBands{minBands};
+    float lowCrossoverInHz{150.0f};
+    float highCrossoverInHz{5000.0f};
+
+    BlockBiquad::Coefficients lowPass[maxBands - 1];
+    BlockBiquad::Coefficients highPass[maxBands - 1];
+    BlockBiquad::Coefficients allPass[maxBands - 1];
+    std::vector<ChainState> chains;
+
+    // [band][channel] of bandStride samples each, bandChannels points into it band by band
+    std::vector<float> bandSignal;
+    std::vector<float*> bandChannels;
+    DelayLine bandDelay;
+
+    GainComputer gainComputers[maxBands];
+    LevelDetector ballistics[maxBands];
+    float makeup[maxBands]{};
+    float mix{1.0f};
+    bool exactMode{false};
+
+    // Fork-join state of the parallel mode, one task per band
+    std::vector<std::thread> workers;
+    std::mutex workerMutex;
+    std::condition_variable workAvailable;
+    std::condition_variable workFinished;
+    int generation{0};
+    int unfinishedTasks{0};
+    bool stopping{false};
+    std::atomic<int> nextTask{0};
+    const float* const* taskChannels{nullptr};
+    int taskNumChannels{0};
+    int taskNumSamples{0};
+};
@@ -0,0 +1,59 @@
+/*
+  ==============================================================================
+    File:           SidechainFilter.h
+    Developers:     D. Robert Hoover and Kris Keillor
+    Repository URL: https://github.com/Top-Notch-DSP/GlobeLoveler
+    Date:           2024 Feb 1
+    License:        GNU General Public License, version 3.0 (GPL-3.0)
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "BlockBiquad.h"
+
+/* SidechainFilter:
+ * High-pass and tilt EQ for the detection signal, two BlockBiquad sections per channel.
+ * The tilt is a high shelf at tiltPivotInHz whose broadband gain is lowered by half the tilt,
+ * so lows drop and highs rise by the same amount around the pivot.
+ */
+class SidechainFilter
+{
+public:
+    static constexpr float tiltPivotInHz = 1000.0f;
+
+    SidechainFilter() = default;
+
+    // Allocates the state of every channel
+    void prepare(double sampleRate, int numChannels);
+
+    // Recomputes the coefficients for another rate and clears the state, never allocates
+    void setSampleRate(double sampleRate);
+
+    // Sets the high-pass cutoff in Hz, 0 switches it off
+    void setHighPass(float);
+
+    // Sets the tilt in dB from lows to highs, positive brightens the side-chain
+    void setTilt(float);
+
+    // False while both sections are switched off, process() then leaves the signal as is
+    bool isActive() const;
+
+    // Clears the state of every channel
+    void reset();
+
+    // Filters numSamples of one channel in place
+    void process(int channel, float* data, int numSamples);
+
+private:
+    void updateCoefficients();
+
+    double sampleRate{44100.0};
+    float highPassInHz{0.0f};
+    float tiltInDecibels{0.0f};
+
+    BlockBiquad::Coefficients highPass;
+    BlockBiquad::Coefficients tilt;
+    std::vector<BlockBiquad::State> highPassState;
+    std::vector<BlockBiquad::State> tiltState;
+};
@@ -0,0 +1,103 @@
+/*
+  ==============================================================================
+    File:           TruePeakLimiter.h
+    Developers:     D. Robert Hoover and Kris Keillor
+    Repository URL: https://github.com/Top-Notch-DSP/GlobeLoveler
+    Date:           2024 Feb 1
+    License:        GNU General Public License, version 3.0 (GPL-3.0)
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "DelayLine.h"
+#include "../JuceLibraryCode/JuceHeader.h"
+
+/* TruePeakLimiter:
+ * Brickwall limiter on the 4x oversampled (inter-sample) peak of all channels.
+ * The gain each peak needs is spread over a short lookahead: a sliding-window minimum
+ * (monotonic deque, O(1) amortised per sample) holds it for the window, an exponential release
+ * lets it recover and a moving average of the same length smooths the onset.
+ * The averaged gain can't exceed the minimum inside its window, so it has reached
+ * the required gain when the peak leaves the delay line.
+ */
+class TruePeakLimiter
+{
+public:
+    static constexpr int oversamplingFactor = 4;
+    static constexpr int tapsPerPhase = 12;
+    static constexpr float lookaheadInMs = 1.5f;
+
+    TruePeakLimiter() = default;
+
+    // Allocates every buffer for the given block size and channel count
+    void prepare(const dsp::ProcessSpec& ps);
+
+    // Sets the true-peak ceiling in dBTP
+    void setCeiling(float);
+
+    // Sets the release time in milliseconds
+    void setRelease(float);
+
+    // Clears the delay line and the gain envelope, never allocates
+    void reset();
+
+    // Delay of the audio path in samples
+    int getLatencySamples() const;
+
+    // Samples until two runs that started from different states differ by less than maxErrorInDecibels,
+    // assuming the limiter reduces by no more than maxAttenuationInDecibels
+    int64 getSettlingSamples(float maxErrorInDecibels, float maxAttenuationInDecibels = 20.0f) const;
+
+    // Largest gain reduction of the last block in dB, <= 0
+    float getMaxGainReduction() const;
+
+    // Limits up to the number of channels given in prepare() in place
+    void process(AudioBuffer<float>& buffer);
+
+private:
+    // Interpolation filters for the oversampled positions between two samples, windowed sinc
+    void computeInterpolationFilters();
+
+    // Writes the largest true-peak estimate over all channels per sample into truePeak
+    void detectTruePeak(const float* const* channels, int numChannels, int numSamples);
+
+    // Sliding-window minimum over the last windowLength values, ring buffer of (index, value) pairs
+    struct SlidingMinimum
+    {
+        void prepare(int windowLength);
+        void reset();
+        float push(float value);
+
+        std::vector<int64> indices;
+        std::vector<float> values;
+        int window{1};
+        int head{0};
+        int size{0};
+        int64 count{0};
+    };
+
+    dsp::ProcessSpec procSpec{-1, 0, 0};
+    float coefficients[oversamplingFactor - 1][tapsPerPhase]{};
+
+    // Per channel the last tapsPerPhase - 1 input samples followed by the current block
+    std::vector<float> history;
+    int historyStride{0};
+    std::vector<float> truePeak;
+    std::vector<float> interpolated;
+    std::vector<float> gain;
+
+    SlidingMinimum minimum;
+    std::vector<float> averageWindow;
+    double averageSum{0.0};
+    int averagePosition{0};
+    int windowLength{1};
+
+    DelayLine delay;
+
+    float ceiling{1.0f};
+    double releaseTimeInSeconds{0.05};
+    float releaseCoefficient{0.0f};
+    float releaseState{1.0f};
+    float maxGainReduction{0.0f};
+};
@@ -0,0 +1,67 @@
+/*
+  ==============================================================================
+    File:           VectorKernels.h
+    Developers:     D. Robert Hoover and Kris Keillor
+    Repository URL: https://github.com/Top-Notch-DSP/GlobeLoveler
+    Date:           2024 Feb 1
+    License:        GNU General Public License, version 3.0 (GPL-3.0)
+  ==============================================================================
+*/
+
+#pragma once
+
+/* VectorKernels:
+ * SIMD implementations of the per-sample stages of the compressor.
+ * The instruction set (AVX2, SSE2, NEON or plain scalar) is selected once at runtime
+ * from the features of the host CPU. The scalar methods of GainComputer stay the reference.
+ */
+namespace VectorKernels
+{
+    // Static curve of the gain computer in the form the kernels consume
+    struct GainCurve
+    {
+        float threshold{-20.0f};
+        float kneeHalf{3.0f};
+        float slope{-0.5f};
+        float kneeScale{0.0f}; // 0.5 * slope / knee, zero for a hard knee
+    };
+
+    // Interleaved lanes of a frame in computeAttenuationLanes, one AVX2 register
+    constexpr int laneCount = 8;
+
+    // One GainCurve per lane
+    struct LaneCurves
+    {
+        alignas(32) float threshold[laneCount];
+        alignas(32) float kneeHalf[laneCount];
+        alignas(32) float slope[laneCount];
+        alignas(32) float kneeScale[laneCount];
+    };
+
+    // Converts a linear side-chain buffer in-place to attenuation in dB.
+    // log2 is approximated by a 6th order polynomial on the mantissa (|error| < 2.2e-6),
+    // so results deviate from GainComputer::applyCompression by less than 4e-5 dB, rounding of the float
+    // reference included.
+    void computeAttenuation(float* src, int numSamples, const GainCurve& curve);
+
+    // computeAttenuation for a curve with kneeHalf == 0, without evaluating the knee.
+    // Bit-identical to computeAttenuation on such a curve
+    void computeAttenuationHardKnee(float* src, int numSamples, const GainCurve& curve);
+
+    // computeAttenuation on frames of laneCount interleaved lanes, lane k following the k-th curve.
+    // Independent side-chains, e.g. the bands of a multiband compressor, vectorise across lanes
+    void computeAttenuationLanes(float* frames, int numFrames, const LaneCurves& curves);
+
+    // Adds offsetInDecibels to every sample and converts the buffer in-place to linear gain,
+    // the fused equivalent of Decibels::decibelsToGain(src[i] + offsetInDecibels).
+    // exp2 is approximated by a 5th order polynomial on the fractional part (relative error < 1.8e-7).
+    // Including rounding of the scaled input, results stay within 2e-6 relative (about 1.7e-5 dB)
+    // of decibelsToGainExact. Inputs <= -100 dB map to 0.
+    void decibelsToGain(float* src, float offsetInDecibels, int numSamples);
+
+    // Exact scalar fallback for decibelsToGain, one std::pow per sample
+    void decibelsToGainExact(float* src, float offsetInDecibels, int numSamples);
+
+    // Returns the name of the instruction set the kernels dispatch to
+    const char* getInstructionSetName();
+}
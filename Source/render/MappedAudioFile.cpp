@@ -0,0 +1,428 @@
+/*
+  ==============================================================================
+    File:           MappedAudioFile.cpp
+    Developers:     D. Robert Hoover and Kris Keillor
+    Repository URL: https://github.com/Top-Notch-DSP/GlobeLoveler
+    Date:           2024 Feb 1
+    License:        GNU General Public License, version 3.0 (GPL-3.0)
+  ==============================================================================
+*/
+
+#include "include/MappedAudioFile.h"
+#include <cmath>
+
+namespace
+{
+    // Chunk ids as read by InputStream::readInt(), which is little-endian
+    constexpr int fourCC(const char (&id)[5])
+    {
+        return static_cast<int>(static_cast<uint32>(static_cast<uint8>(id[0]))
+                                | (static_cast<uint32>(static_cast<uint8>(id[1])) << 8)
+                                | (static_cast<uint32>(static_cast<uint8>(id[2])) << 16)
+                                | (static_cast<uint32>(static_cast<uint8>(id[3])) << 24));
+    }
+
+    constexpr int waveFormatPcm = 1;
+    constexpr int waveFormatFloat = 3;
+    constexpr int waveFormatExtensible = 0xfffe;
+
+    // 80 bit IEEE extended, the sample rate format of AIFF
+    double readExtended(InputStream& in)
+    {
+        uint8 bytes[10];
+        if (in.read(bytes, 10) != 10)
+            return 0.0;
+
+        const int exponent = ((bytes[0] & 0x7f) << 8) | bytes[1];
+        uint64 mantissa = 0;
+        for (int i = 2; i < 10; ++i)
+            mantissa = (mantissa << 8) | bytes[i];
+
+        return std::ldexp(static_cast<double>(mantissa), exponent - 16383 - 63);
+    }
+}
+
+//==============================================================================
+MappedWindow::MappedWindow(const File& fileToMap, MemoryMappedFile::AccessMode accessMode, int64 size)
+    : file(fileToMap), mode(accessMode), windowSize(size), fileSize(fileToMap.getSize())
+{
+}
+
+uint8* MappedWindow::map(int64 position, int64 numBytes)
+{
+    const Range<int64> wanted(position, position + numBytes);
+
+    if (mapping == nullptr || !mapping->getRange().contains(wanted))
+    {
+        mapping.reset();
+        if (wanted.getEnd() > fileSize)
+            return nullptr;
+
+        // The mapping starts at the page boundary below position, getRange() tells where exactly
+        const Range<int64> range(position, jmin(fileSize, position + jmax(windowSize, numBytes)));
+        mapping = std::make_unique<MemoryMappedFile>(file, range, mode);
+
+        if (mapping->getData() == nullptr || !mapping->getRange().contains(wanted))
+        {
+            mapping.reset();
+            return nullptr;
+        }
+    }
+
+    return static_cast<uint8*>(mapping->getData()) + (position - mapping->getRange().getStart());
+}
+
+void MappedWindow::release()
+{
+    mapping.reset();
+}
+
+//==============================================================================
+MappedAudioFormatReader::MappedAudioFormatReader(const File& file, const String& formatName)
+    : AudioFormatReader(nullptr, formatName),
+      window(file, MemoryMappedFile::readOnly)
+{
+}
+
+std::unique_ptr<MappedAudioFormatReader> MappedAudioFormatReader::create(const File& file)
+{
+    FileInputStream in(file);
+    if (in.failedToOpen())
+        return nullptr;
+
+    const auto container = in.readInt();
+    in.readInt(); // Container size, chunks are walked up to the real file size
+    const auto type = in.readInt();
+
+    std::unique_ptr<MappedAudioFormatReader> reader;
+    if (container == fourCC("RIFF") && type == fourCC("WAVE"))
+    {
+        reader.reset(new MappedAudioFormatReader(file, "WAV file"));
+        if (!reader->parseWav(in))
+            return nullptr;
+    }
+    else if (container == fourCC("FORM") && (type == fourCC("AIFF") || type == fourCC("AIFC")))
+    {
+        reader.reset(new MappedAudioFormatReader(file, "AIFF file"));
+        if (!reader->parseAiff(in))
+            return nullptr;
+    }
+    else
+        return nullptr;
+
+    // Clamp truncated or open-ended data chunks to what is actually in the file
+    const auto availableFrames = (file.getSize() - reader->dataOffset) / reader->frameBytes;
+    reader->lengthInSamples = jlimit<int64>(0, jmax<int64>(0, availableFrames), reader->lengthInSamples);
+    reader->usesFloatingPointData = true;
+    reader->channelPointers.resize(reader->numChannels);
+    return reader;
+}
+
+bool MappedAudioFormatReader::parseWav(FileInputStream& in)
+{
+    int formatTag = 0;
+    bool hasFormat = false;
+    int64 dataSize = -1;
+
+    while (in.getPosition() + 8 <= in.getTotalLength())
+    {
+        const auto id = in.readInt();
+        const auto size = static_cast<int64>(static_cast<uint32>(in.readInt()));
+        const auto chunkStart = in.getPosition();
+
+        if (id == fourCC("fmt "))
+        {
+            formatTag = static_cast<uint16>(in.readShort());
+            numChannels = static_cast<unsigned int>(static_cast<uint16>(in.readShort()));
+            sampleRate = static_cast<uint32>(in.readInt());
+            in.readInt();   // Bytes per second
+            in.readShort(); // Block align
+            bitsPerSample = static_cast<unsigned int>(static_cast<uint16>(in.readShort()));
+
+            // The sub-format GUID starts with the plain format tag
+            if (formatTag == waveFormatExtensible && size >= 40)
+            {
+                in.readShort(); // Extension size
+                in.readShort(); // Valid bits
+                in.readInt();   // Channel mask
+                formatTag = static_cast<uint16>(in.readShort());
+            }
+            hasFormat = true;
+        }
+        else if (id == fourCC("data"))
+        {
+            dataOffset = chunkStart;
+            dataSize = size;
+            break;
+        }
+
+        in.setPosition(chunkStart + size + (size & 1));
+    }
+
+    if (!hasFormat || dataSize < 0 || numChannels == 0 || sampleRate <= 0.0)
+        return false;
+
+    if (formatTag == waveFormatPcm && bitsPerSample == 16)
+        sampleFormat = PcmKernels::SampleFormat::int16LE;
+    else if (formatTag == waveFormatPcm && bitsPerSample == 24)
+        sampleFormat = PcmKernels::SampleFormat::int24LE;
+    else if (formatTag == waveFormatPcm && bitsPerSample == 32)
+        sampleFormat = PcmKernels::SampleFormat::int32LE;
+    else if (formatTag == waveFormatFloat && bitsPerSample == 32)
+        sampleFormat = PcmKernels::SampleFormat::float32LE;
+    else
+        return false;
+
+    frameBytes = PcmKernels::getBytesPerSample(sampleFormat) * static_cast<int>(numChannels);
+    lengthInSamples = dataSize / frameBytes;
+    return true;
+}
+
+bool MappedAudioFormatReader::parseAiff(FileInputStream& in)
+{
+    in.setPosition(8);
+    const bool isAifc = in.readInt() == fourCC("AIFC");
+    int compression = fourCC("NONE");
+    bool hasCommon = false;
+    bool hasData = false;
+
+    while (in.getPosition() + 8 <= in.getTotalLength())
+    {
+        const auto id = in.readInt();
+        const auto size = static_cast<int64>(static_cast<uint32>(in.readIntBigEndian()));
+        const auto chunkStart = in.getPosition();
+
+        if (id == fourCC("COMM"))
+        {
+            numChannels = static_cast<unsigned int>(static_cast<uint16>(in.readShortBigEndian()));
+            lengthInSamples = static_cast<uint32>(in.readIntBigEndian());
+            bitsPerSample = static_cast<unsigned int>(static_cast<uint16>(in.readShortBigEndian()));
+            sampleRate = readExtended(in);
+            if (isAifc)
+                compression = in.readInt();
+            hasCommon = true;
+        }
+        else if (id == fourCC("SSND"))
+        {
+            const auto offset = static_cast<uint32>(in.readIntBigEndian());
+            dataOffset = chunkStart + 8 + offset;
+            hasData = true;
+        }
+
+        if (hasCommon && hasData)
+            break;
+
+        in.setPosition(chunkStart + size + (size & 1));
+    }
+
+    if (!hasCommon || !hasData || numChannels == 0 || sampleRate <= 0.0)
+        return false;
+
+    const bool littleEndian = compression == fourCC("sowt");
+    if (compression == fourCC("fl32") || compression == fourCC("FL32"))
+    {
+        if (bitsPerSample != 32)
+            return false;
+        sampleFormat = PcmKernels::SampleFormat::float32BE;
+    }
+    else if (compression == fourCC("NONE") || littleEndian)
+    {
+        if (bitsPerSample == 16)
+            sampleFormat = littleEndian ? PcmKernels::SampleFormat::int16LE : PcmKernels::SampleFormat::int16BE;
+        else if (bitsPerSample == 24)
+            sampleFormat = littleEndian ? PcmKernels::SampleFormat::int24LE : PcmKernels::SampleFormat::int24BE;
+        else if (bitsPerSample == 32)
+            sampleFormat = littleEndian ? PcmKernels::SampleFormat::int32LE : PcmKernels::SampleFormat::int32BE;
+        else
+            return false;
+    }
+    else
+        return false;
+
+    frameBytes = PcmKernels::getBytesPerSample(sampleFormat) * static_cast<int>(numChannels);
+    return true;
+}
+
+bool MappedAudioFormatReader::readSamples(int* const* destChannels, int numDestChannels, int startOffsetInDestBuffer,
+                                          int64 startSampleInFile, int numSamples)
+{
+    clearSamplesBeyondAvailableLength(destChannels, numDestChannels, startOffsetInDestBuffer, startSampleInFile,
+                                      numSamples, lengthInSamples);
+    if (numSamples <= 0)
+        return true;
+
+    // usesFloatingPointData, the int pointers hold floats
+    for (int ch = 0; ch < static_cast<int>(numChannels); ++ch)
+        channelPointers[ch] = ch < numDestChannels && destChannels[ch] != nullptr
+                                  ? reinterpret_cast<float*>(destChannels[ch]) + startOffsetInDestBuffer
+                                  : nullptr;
+
+    // Convert window by window so a large request never maps more than one window
+    const int framesPerWindow = jmax(1, static_cast<int>(window.getWindowSize() / frameBytes));
+
+    for (int done = 0; done < numSamples;)
+    {
+        const int numFrames = jmin(framesPerWindow, numSamples - done);
+        const auto* source = window.map(dataOffset + (startSampleInFile + done) * frameBytes,
+                                        static_cast<int64>(numFrames) * frameBytes);
+        if (source == nullptr)
+            return false;
+
+        PcmKernels::deinterleave(source, sampleFormat, static_cast<int>(numChannels), channelPointers.data(), numFrames);
+
+        for (auto& pointer : channelPointers)
+            if (pointer != nullptr)
+                pointer += numFrames;
+        done += numFrames;
+    }
+
+    return true;
+}
+
+//==============================================================================
+MappedWavWriter::MappedWavWriter(const File& fileToWrite, double rate, int channels, int bits, int64 frames)
+    : AudioFormatWriter(nullptr, "WAV file", rate, static_cast<unsigned int>(channels), static_cast<unsigned int>(bits)),
+      file(fileToWrite),
+      window(fileToWrite, MemoryMappedFile::readWrite),
+      sampleFormat(bits == 16 ? PcmKernels::SampleFormat::int16LE
+                   : bits == 24 ? PcmKernels::SampleFormat::int24LE : PcmKernels::SampleFormat::float32LE),
+      frameBytes(PcmKernels::getBytesPerSample(sampleFormat) * channels),
+      numFrames(frames)
+{
+    usesFloatingPointData = true;
+}
+
+std::unique_ptr<MappedWavWriter> MappedWavWriter::create(const File& file, double sampleRate, int numChannels,
+                                                         int bitsPerSample, int64 numFrames)
+{
+    jassert(bitsPerSample == 16 || bitsPerSample == 24 || bitsPerSample == 32);
+
+    const int64 dataBytes = numFrames * numChannels * (bitsPerSample / 8);
+    const auto header = createHeader(numChannels, sampleRate, bitsPerSample, dataBytes);
+    if (numChannels <= 0 || static_cast<int64>(header.getSize()) + dataBytes + 1 > 0xffffffffLL)
+        return nullptr;
+
+    // Header plus zeroed (sparse) data, padded to an even length
+    {
+        file.deleteFile();
+        FileOutputStream out(file);
+        if (out.failedToOpen() || !out.write(header.getData(), header.getSize()))
+            return nullptr;
+
+        const auto totalSize = static_cast<int64>(header.getSize()) + dataBytes + (dataBytes & 1);
+        if (totalSize > out.getPosition() && (!out.setPosition(totalSize - 1) || !out.writeByte(0)))
+            return nullptr;
+        out.flush();
+        if (out.getStatus().failed())
+            return nullptr;
+    }
+
+    std::unique_ptr<MappedWavWriter> writer(new MappedWavWriter(file, sampleRate, numChannels, bitsPerSample, numFrames));
+    writer->dataOffset = static_cast<int64>(header.getSize());
+    return writer;
+}
+
+MappedWavWriter::~MappedWavWriter()
+{
+    window.release();
+
+    if (framesWritten == numFrames)
+        return;
+
+    // Fewer frames arrived than announced, shrink the header and the file to match
+    const auto dataBytes = framesWritten * frameBytes;
+    const auto header = createHeader(static_cast<int>(numChannels), sampleRate, static_cast<int>(bitsPerSample), dataBytes);
+
+    FileOutputStream out(file);
+    if (out.openedOk())
+    {
+        out.setPosition(0);
+        out.write(header.getData(), header.getSize());
+        out.setPosition(dataOffset + dataBytes);
+        if (dataBytes & 1)
+            out.writeByte(0);
+        out.flush();
+        out.truncate();
+    }
+}
+
+MemoryBlock MappedWavWriter::createHeader(int numChannels, double sampleRate, int bitsPerSample, int64 dataBytes)
+{
+    // Plain PCM/float for mono and stereo, WAVE_FORMAT_EXTENSIBLE for more channels
+    const bool isFloat = bitsPerSample == 32;
+    const bool extensible = numChannels > 2;
+    const int formatTag = isFloat ? waveFormatFloat : waveFormatPcm;
+    const int formatSize = extensible ? 40 : (isFloat ? 18 : 16);
+    const int blockAlign = numChannels * bitsPerSample / 8;
+
+    MemoryOutputStream out;
+    out.writeInt(fourCC("RIFF"));
+    out.writeInt(static_cast<int>(4 + 8 + formatSize + 8 + dataBytes + (dataBytes & 1)));
+    out.writeInt(fourCC("WAVE"));
+
+    out.writeInt(fourCC("fmt "));
+    out.writeInt(formatSize);
+    out.writeShort(static_cast<short>(extensible ? waveFormatExtensible : formatTag));
+    out.writeShort(static_cast<short>(numChannels));
+    out.writeInt(static_cast<int>(sampleRate));
+    out.writeInt(static_cast<int>(sampleRate) * blockAlign);
+    out.writeShort(static_cast<short>(blockAlign));
+    out.writeShort(static_cast<short>(bitsPerSample));
+
+    if (extensible)
+    {
+        // KSDATAFORMAT_SUBTYPE_PCM / _IEEE_FLOAT: {0000000x-0000-0010-8000-00aa00389b71}
+        static const uint8 guidTail[14] = {0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80, 0x00,
+                                           0x00, 0xaa, 0x00, 0x38, 0x9b, 0x71};
+        out.writeShort(22);
+        out.writeShort(static_cast<short>(bitsPerSample));
+        out.writeInt(0); // No speaker positions
+        out.writeShort(static_cast<short>(formatTag));
+        out.write(guidTail, sizeof(guidTail));
+    }
+    else if (isFloat)
+        out.writeShort(0);
+
+    out.writeInt(fourCC("data"));
+    out.writeInt(static_cast<int>(dataBytes));
+
+    return out.getMemoryBlock();
+}
+
+bool MappedWavWriter::write(const int** samplesToWrite, int numSamples)
+{
+    if (framesWritten + numSamples > numFrames)
+        return false;
+
+    // usesFloatingPointData, the int pointers hold floats
+    const float* source[64];
+    const auto channels = static_cast<int>(numChannels);
+    if (channels > 64)
+        return false;
+
+    for (int ch = 0; ch < channels; ++ch)
+    {
+        if (samplesToWrite[ch] == nullptr)
+            return false;
+        source[ch] = reinterpret_cast<const float*>(samplesToWrite[ch]);
+    }
+
+    const int framesPerWindow = jmax(1, static_cast<int>(window.getWindowSize() / frameBytes));
+
+    for (int done = 0; done < numSamples;)
+    {
+        const int frames = jmin(framesPerWindow, numSamples - done);
+        auto* dest = window.map(dataOffset + (framesWritten + done) * frameBytes, static_cast<int64>(frames) * frameBytes);
+        if (dest == nullptr)
+            return false;
+
+        PcmKernels::interleave(source, channels, dest, sampleFormat, frames);
+
+        for (int ch = 0; ch < channels; ++ch)
+            source[ch] += frames;
+        done += frames;
+    }
+
+    framesWritten += numSamples;
+    return true;
+}
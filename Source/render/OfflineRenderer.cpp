@@ -0,0 +1,320 @@
+/*
+  ==============================================================================
+    File:           OfflineRenderer.cpp
+    Developers:     D. Robert Hoover and Kris Keillor
+    Repository URL: https://github.com/Top-Notch-DSP/GlobeLoveler
+    Date:           2024 Feb 1
+    License:        GNU General Public License, version 3.0 (GPL-3.0)
+  ==============================================================================
+*/
+
+#include "include/OfflineRenderer.h"
+#include "include/MappedAudioFile.h"
+#include "../PluginProcessor.h"
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+OfflineRenderer::OfflineRenderer(const Settings& renderSettings)
+    : settings(renderSettings)
+{
+    jassert(settings.blockSize > 0);
+}
+
+Result OfflineRenderer::loadPreset(const File& presetFile)
+{
+    auto xml = parseXML(presetFile);
+    if (xml == nullptr)
+        return Result::fail("Could not parse preset " + presetFile.getFullPathName());
+
+    // A bare parameter tree gets wrapped the way getStateInformation stores it
+    if (xml->hasTagName("PARAMETERS"))
+    {
+        auto root = std::make_unique<XmlElement>("GlobeLovelerState");
+        root->addChildElement(xml.release());
+        xml = std::move(root);
+    }
+
+    if (xml->getChildByName("PARAMETERS") == nullptr)
+        return Result::fail("No PARAMETERS element in preset " + presetFile.getFullPathName());
+
+    presetState.reset();
+    AudioProcessor::copyXmlToBinary(*xml, presetState);
+    return Result::ok();
+}
+
+File OfflineRenderer::getOutputFileFor(const File& inputFile) const
+{
+    const auto directory = settings.outputDirectory == File() ? inputFile.getParentDirectory()
+                                                              : settings.outputDirectory;
+    return directory.getChildFile(inputFile.getFileNameWithoutExtension() + settings.outputSuffix + ".wav");
+}
+
+Result OfflineRenderer::renderFile(const File& inputFile, const File& outputFile, Stats* stats) const
+{
+    const auto startTicks = Time::getHighResolutionTicks();
+
+    auto reader = createReader(inputFile);
+    if (reader == nullptr)
+        return Result::fail("Could not open " + inputFile.getFullPathName());
+
+    auto writer = createWriter(outputFile, *reader);
+    if (writer == nullptr)
+        return Result::fail("Could not create " + outputFile.getFullPathName());
+
+    const auto result = settings.segmentThreads > 1 ? renderSegmented(inputFile, *reader, *writer)
+                                                    : renderSerial(*reader, *writer);
+    if (result.failed())
+        return Result::fail(result.getErrorMessage() + " in " + inputFile.getFullPathName());
+
+    writer.reset(); // Flushes and closes the file, part of the wall time
+
+    if (stats != nullptr)
+    {
+        stats->numSamples = reader->lengthInSamples;
+        stats->sampleRate = reader->sampleRate;
+        stats->wallSeconds = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - startTicks);
+    }
+
+    return Result::ok();
+}
+
+std::unique_ptr<AudioFormatReader> OfflineRenderer::createReader(const File& inputFile) const
+{
+    if (settings.memoryMapped)
+        if (auto reader = MappedAudioFormatReader::create(inputFile))
+            return reader;
+
+    AudioFormatManager formatManager;
+    formatManager.registerBasicFormats();
+    return std::unique_ptr<AudioFormatReader>(formatManager.createReaderFor(inputFile));
+}
+
+std::unique_ptr<AudioFormatWriter> OfflineRenderer::createWriter(const File& outputFile,
+                                                                const AudioFormatReader& reader) const
+{
+    // WAV stores 16, 24 or 32 (float) bits, anything else is written as 24 bit
+    const auto bitsPerSample = reader.bitsPerSample == 16 || reader.bitsPerSample == 32
+                                   ? static_cast<int>(reader.bitsPerSample) : 24;
+
+    // The mapped writer needs the length up front and a plain RIFF size, otherwise stream
+    if (settings.memoryMapped)
+        if (auto writer = MappedWavWriter::create(outputFile, reader.sampleRate, static_cast<int>(reader.numChannels),
+                                                  bitsPerSample, reader.lengthInSamples))
+            return writer;
+
+    outputFile.deleteFile();
+    auto stream = outputFile.createOutputStream();
+    if (stream == nullptr)
+        return nullptr;
+
+    WavAudioFormat wavFormat;
+    std::unique_ptr<AudioFormatWriter> writer(wavFormat.createWriterFor(stream.get(), reader.sampleRate,
+                                                                        reader.numChannels, bitsPerSample,
+                                                                        reader.metadataValues, 0));
+    if (writer != nullptr)
+        stream.release(); // Now owned by the writer
+    return writer;
+}
+
+std::unique_ptr<GlobeLoveler> OfflineRenderer::createProcessor(int numChannels, double sampleRate) const
+{
+    // Same layout in and out, canonical sets give surround files their detection groups
+    auto channelSet = AudioChannelSet::canonicalChannelSet(numChannels);
+    if (channelSet.isDisabled())
+        channelSet = AudioChannelSet::discreteChannels(numChannels);
+
+    // The sidechain bus stays disabled, files are compressed by their own level
+    auto processor = std::make_unique<GlobeLoveler>();
+    auto layout = processor->getBusesLayout();
+    layout.inputBuses.getReference(0) = channelSet;
+    layout.outputBuses.getReference(0) = channelSet;
+    if (!processor->setBusesLayout(layout))
+        return nullptr;
+
+    if (presetState.getSize() > 0)
+        processor->setStateInformation(presetState.getData(), static_cast<int>(presetState.getSize()));
+
+    processor->setNonRealtime(true);
+    processor->setParallelBands(settings.parallelBands);
+    processor->setRateAndBufferSizeDetails(sampleRate, settings.blockSize);
+    processor->prepareToPlay(sampleRate, settings.blockSize);
+    return processor;
+}
+
+Result OfflineRenderer::process(GlobeLoveler& processor, AudioFormatReader& reader, AudioBuffer<float>& buffer,
+                                int64 readerStart) const
+{
+    MidiBuffer midi;
+
+    for (int start = 0; start < buffer.getNumSamples(); start += settings.blockSize)
+    {
+        const auto numSamples = jmin(settings.blockSize, buffer.getNumSamples() - start);
+
+        // The last block is shorter, process a view so the processor sees the real length
+        AudioBuffer<float> block(buffer.getArrayOfWritePointers(), buffer.getNumChannels(), start, numSamples);
+        if (!reader.read(&block, 0, numSamples, readerStart + start, true, true))
+            return Result::fail("Read error");
+
+        processor.processBlock(block, midi);
+    }
+
+    return Result::ok();
+}
+
+Result OfflineRenderer::skipLatency(GlobeLoveler& processor, AudioFormatReader& reader, int64 readerStart) const
+{
+    const auto latency = processor.getLatencySamples();
+    if (latency <= 0)
+        return Result::ok();
+
+    AudioBuffer<float> discarded(static_cast<int>(reader.numChannels), latency);
+    return process(processor, reader, discarded, readerStart);
+}
+
+Result OfflineRenderer::renderSerial(AudioFormatReader& reader, AudioFormatWriter& writer) const
+{
+    const auto numChannels = static_cast<int>(reader.numChannels);
+    auto processor = createProcessor(numChannels, reader.sampleRate);
+    if (processor == nullptr)
+        return Result::fail("Unsupported channel count " + String(numChannels));
+
+    // Output is aligned with the input, the lookahead is read ahead instead of written as a delay
+    const auto latencyResult = skipLatency(*processor, reader, 0);
+    if (latencyResult.failed())
+        return latencyResult;
+    const auto latency = processor->getLatencySamples();
+
+    AudioBuffer<float> buffer(numChannels, settings.blockSize);
+
+    for (int64 position = 0; position < reader.lengthInSamples; position += settings.blockSize)
+    {
+        const auto numSamples = static_cast<int>(jmin<int64>(settings.blockSize, reader.lengthInSamples - position));
+        AudioBuffer<float> block(buffer.getArrayOfWritePointers(), numChannels, numSamples);
+
+        const auto result = process(*processor, reader, block, position + latency);
+        if (result.failed())
+            return result;
+
+        if (!writer.writeFromAudioSampleBuffer(block, 0, numSamples))
+            return Result::fail("Write error");
+    }
+
+    processor->releaseResources();
+    return Result::ok();
+}
+
+Result OfflineRenderer::renderSegmented(const File& inputFile, AudioFormatReader& reader, AudioFormatWriter& writer) const
+{
+    const auto numChannels = static_cast<int>(reader.numChannels);
+    const auto length = reader.lengthInSamples;
+
+    // The pre-roll depends on the preset's attack and release
+    int64 warmUpSamples = 0;
+    {
+        auto probe = createProcessor(numChannels, reader.sampleRate);
+        if (probe == nullptr)
+            return Result::fail("Unsupported channel count " + String(numChannels));
+        warmUpSamples = probe->getSettlingSamples(settings.maxSegmentErrorInDecibels);
+    }
+
+    // Segments of at least four warm-ups keep the pre-roll overhead under 25 %
+    const auto segmentLength = jmax<int64>(settings.blockSize,
+                                           static_cast<int64>(settings.segmentSeconds * reader.sampleRate),
+                                           4 * warmUpSamples);
+    const auto numSegments = static_cast<int>((length + segmentLength - 1) / segmentLength);
+
+    if (numSegments <= 1)
+        return renderSerial(reader, writer);
+
+    struct Segment
+    {
+        AudioBuffer<float> audio;   // Pre-roll followed by the samples to write
+        int warmUp{0};
+        Result result{Result::ok()};
+        bool done{false};
+    };
+
+    std::vector<Segment> segments(static_cast<size_t>(numSegments));
+    std::mutex lock;
+    std::condition_variable changed;
+    int nextSegment = 0;
+    int numWritten = 0;
+    bool aborted = false;
+
+    // Rendered segments wait in memory until written, at most this many are in flight
+    const int maxSegmentsAhead = 2 * settings.segmentThreads;
+
+    auto worker = [&]
+    {
+        auto segmentReader = createReader(inputFile);
+
+        while (true)
+        {
+            int index = 0;
+            {
+                std::unique_lock<std::mutex> scopedLock(lock);
+                changed.wait(scopedLock, [&] { return aborted || nextSegment >= numSegments
+                                                      || nextSegment < numWritten + maxSegmentsAhead; });
+                if (aborted || nextSegment >= numSegments)
+                    return;
+                index = nextSegment++;
+            }
+
+            auto& segment = segments[static_cast<size_t>(index)];
+            const auto start = index * segmentLength;
+            const auto preRollStart = jmax<int64>(0, start - warmUpSamples);
+            const auto end = jmin(length, start + segmentLength);
+
+            // A fresh processor per segment, the ballistics converge during the pre-roll
+            auto processor = segmentReader != nullptr ? createProcessor(numChannels, reader.sampleRate) : nullptr;
+            if (processor == nullptr)
+                segment.result = Result::fail("Could not set up segment " + String(index));
+            else
+            {
+                segment.warmUp = static_cast<int>(start - preRollStart);
+                segment.audio.setSize(numChannels, static_cast<int>(end - preRollStart));
+                segment.result = skipLatency(*processor, *segmentReader, preRollStart);
+                if (segment.result.wasOk())
+                    segment.result = process(*processor, *segmentReader, segment.audio,
+                                             preRollStart + processor->getLatencySamples());
+            }
+
+            const std::lock_guard<std::mutex> scopedLock(lock);
+            segment.done = true;
+            changed.notify_all();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (int i = 0; i < jmin(settings.segmentThreads, numSegments); ++i)
+        workers.emplace_back(worker);
+
+    // Stitch in order on this thread
+    auto result = Result::ok();
+    for (int index = 0; index < numSegments && result.wasOk(); ++index)
+    {
+        auto& segment = segments[static_cast<size_t>(index)];
+        {
+            std::unique_lock<std::mutex> scopedLock(lock);
+            changed.wait(scopedLock, [&] { return segment.done; });
+        }
+
+        result = segment.result;
+        if (result.wasOk() && !writer.writeFromAudioSampleBuffer(segment.audio, segment.warmUp,
+                                                                 segment.audio.getNumSamples() - segment.warmUp))
+            result = Result::fail("Write error");
+
+        segment.audio.setSize(0, 0);
+
+        const std::lock_guard<std::mutex> scopedLock(lock);
+        ++numWritten;
+        aborted = result.failed();
+        changed.notify_all();
+    }
+
+    for (auto& thread : workers)
+        thread.join();
+
+    return result;
+}
@@ -0,0 +1,656 @@
+/*
+  ==============================================================================
+    File:           PcmKernels.cpp
+    Developers:     D. Robert Hoover and Kris Keillor
+    Repository URL: https://github.com/Top-Notch-DSP/GlobeLoveler
+    Date:           2024 Feb 1
+    License:        GNU General Public License, version 3.0 (GPL-3.0)
+  ==============================================================================
+*/
+
+#include "include/PcmKernels.h"
+#include <JuceHeader.h>
+#include <cstdint>
+#include <cstring>
+
+#if JUCE_INTEL
+    #include <immintrin.h>
+    #if defined(__GNUC__)
+        #define PCM_KERNELS_SSE2 __attribute__((target("sse2")))
+    #else
+        #define PCM_KERNELS_SSE2
+    #endif
+#elif (defined(__ARM_NEON) && defined(__aarch64__)) || defined(_M_ARM64)
+    // vcvtnq (round to nearest) only exists on AArch64
+    #include <arm_neon.h>
+    #define PCM_KERNELS_NEON 1
+#endif
+
+namespace PcmKernels
+{
+namespace
+{
+    constexpr float int16Scale = 1.0f / 32768.0f;
+    constexpr float int24Scale = 1.0f / 8388608.0f;
+    constexpr float int32Scale = 1.0f / 2147483648.0f;
+
+    // Largest floats that still convert into the integer range
+    constexpr float int16Max = 32767.0f;
+    constexpr float int24Max = 8388607.0f;
+    constexpr float int32Max = 2147483520.0f;
+
+    //==============================================================================
+    inline uint32_t load32(const uint8_t* p, bool bigEndian)
+    {
+        return bigEndian ? (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3])
+                         : uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+    }
+
+    inline void store32(uint8_t* p, uint32_t v, bool bigEndian)
+    {
+        for (int i = 0; i < 4; ++i)
+            p[bigEndian ? 3 - i : i] = static_cast<uint8_t>(v >> (8 * i));
+    }
+
+    inline float decode(const uint8_t* p, SampleFormat format)
+    {
+        switch (format)
+        {
+        case SampleFormat::int16LE: return static_cast<float>(static_cast<int16_t>(p[0] | (p[1] << 8))) * int16Scale;
+        case SampleFormat::int16BE: return static_cast<float>(static_cast<int16_t>(p[1] | (p[0] << 8))) * int16Scale;
+        case SampleFormat::int24LE:
+            return static_cast<float>(static_cast<int32_t>((uint32_t(p[0]) << 8) | (uint32_t(p[1]) << 16)
+                                                           | (uint32_t(p[2]) << 24)) >> 8) * int24Scale;
+        case SampleFormat::int24BE:
+            return static_cast<float>(static_cast<int32_t>((uint32_t(p[2]) << 8) | (uint32_t(p[1]) << 16)
+                                                           | (uint32_t(p[0]) << 24)) >> 8) * int24Scale;
+        case SampleFormat::int32LE:
+        case SampleFormat::int32BE:
+            return static_cast<float>(static_cast<int32_t>(load32(p, format == SampleFormat::int32BE))) * int32Scale;
+        case SampleFormat::float32LE:
+        case SampleFormat::float32BE:
+        {
+            const uint32_t bits = load32(p, format == SampleFormat::float32BE);
+            float value;
+            std::memcpy(&value, &bits, sizeof(value));
+            return value;
+        }
+        }
+        return 0.0f;
+    }
+
+    inline int32_t quantise(float x, float scale, float maxValue)
+    {
+        // Same clipping and rounding (nearest, ties to even) as the vector paths
+        return static_cast<int32_t>(std::nearbyint(jlimit(-scale, maxValue, x * scale)));
+    }
+
+    inline void encode(float x, uint8_t* p, SampleFormat format)
+    {
+        switch (format)
+        {
+        case SampleFormat::int16LE:
+        case SampleFormat::int16BE:
+        {
+            const auto v = static_cast<uint32_t>(quantise(x, 32768.0f, int16Max));
+            const bool bigEndian = format == SampleFormat::int16BE;
+            p[bigEndian ? 1 : 0] = static_cast<uint8_t>(v);
+            p[bigEndian ? 0 : 1] = static_cast<uint8_t>(v >> 8);
+            break;
+        }
+        case SampleFormat::int24LE:
+        case SampleFormat::int24BE:
+        {
+            const auto v = static_cast<uint32_t>(quantise(x, 8388608.0f, int24Max));
+            const bool bigEndian = format == SampleFormat::int24BE;
+            for (int i = 0; i < 3; ++i)
+                p[bigEndian ? 2 - i : i] = static_cast<uint8_t>(v >> (8 * i));
+            break;
+        }
+        case SampleFormat::int32LE:
+        case SampleFormat::int32BE:
+            store32(p, static_cast<uint32_t>(quantise(x, 2147483648.0f, int32Max)), format == SampleFormat::int32BE);
+            break;
+        case SampleFormat::float32LE:
+        case SampleFormat::float32BE:
+        {
+            uint32_t bits;
+            std::memcpy(&bits, &x, sizeof(bits));
+            store32(p, bits, format == SampleFormat::float32BE);
+            break;
+        }
+        }
+    }
+
+    //==============================================================================
+    // Scalar versions, also used for the frames left over by the vector loops
+    void deinterleaveScalar(const uint8_t* src, SampleFormat format, int numChannels, float* const* dest,
+                            int startFrame, int numFrames)
+    {
+        const int bytesPerSample = getBytesPerSample(format);
+        const int frameBytes = bytesPerSample * numChannels;
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            if (dest[ch] == nullptr)
+                continue;
+
+            const uint8_t* p = src + static_cast<size_t>(startFrame) * frameBytes + ch * bytesPerSample;
+            for (int i = startFrame; i < numFrames; ++i, p += frameBytes)
+                dest[ch][i] = decode(p, format);
+        }
+    }
+
+    void interleaveScalar(const float* const* source, int numChannels, uint8_t* dst, SampleFormat format,
+                          int startFrame, int numFrames)
+    {
+        const int bytesPerSample = getBytesPerSample(format);
+        const int frameBytes = bytesPerSample * numChannels;
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            uint8_t* p = dst + static_cast<size_t>(startFrame) * frameBytes + ch * bytesPerSample;
+            for (int i = startFrame; i < numFrames; ++i, p += frameBytes)
+                encode(source[ch][i], p, format);
+        }
+    }
+
+    // The vector loops only take little-endian mono/stereo data with every destination present
+    bool hasVectorPath(SampleFormat format, int numChannels, const float* const* channels)
+    {
+        if (numChannels < 1 || numChannels > 2)
+            return false;
+        if (format != SampleFormat::int16LE && format != SampleFormat::int24LE && format != SampleFormat::int32LE
+            && format != SampleFormat::float32LE)
+            return false;
+        for (int ch = 0; ch < numChannels; ++ch)
+            if (channels[ch] == nullptr)
+                return false;
+        return true;
+    }
+
+    //==============================================================================
+#if JUCE_INTEL
+    // Four packed 24 bit samples to sign-extended int32 lanes. Sample k starts at byte 3k, a shift by k bytes
+    // moves it to the start of lane k, the lane's top byte is shifted out by the sign extension
+    PCM_KERNELS_SSE2 inline __m128i load24(const uint8_t* p)
+    {
+        int32_t tail;
+        std::memcpy(&tail, p + 8, sizeof(tail));
+        const __m128i v = _mm_unpacklo_epi64(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)),
+                                             _mm_cvtsi32_si128(tail));
+
+        const __m128i lane0 = _mm_set_epi32(0, 0, 0, -1);
+        const __m128i lane1 = _mm_set_epi32(0, 0, -1, 0);
+        const __m128i lane2 = _mm_set_epi32(0, -1, 0, 0);
+        const __m128i lane3 = _mm_set_epi32(-1, 0, 0, 0);
+        const __m128i spread = _mm_or_si128(_mm_or_si128(_mm_and_si128(v, lane0),
+                                                         _mm_and_si128(_mm_slli_si128(v, 1), lane1)),
+                                            _mm_or_si128(_mm_and_si128(_mm_slli_si128(v, 2), lane2),
+                                                         _mm_and_si128(_mm_slli_si128(v, 3), lane3)));
+        return _mm_srai_epi32(_mm_slli_epi32(spread, 8), 8);
+    }
+
+    // The low 24 bits of four int32 lanes as 12 packed bytes, the reverse shifts of load24
+    PCM_KERNELS_SSE2 inline void store24(uint8_t* p, __m128i v)
+    {
+        const __m128i lane0 = _mm_set_epi32(0, 0, 0, 0x00ffffff);
+        const __m128i lane1 = _mm_set_epi32(0, 0, 0x00ffffff, 0);
+        const __m128i lane2 = _mm_set_epi32(0, 0x00ffffff, 0, 0);
+        const __m128i lane3 = _mm_set_epi32(0x00ffffff, 0, 0, 0);
+        const __m128i packed = _mm_or_si128(_mm_or_si128(_mm_and_si128(v, lane0),
+                                                         _mm_srli_si128(_mm_and_si128(v, lane1), 1)),
+                                            _mm_or_si128(_mm_srli_si128(_mm_and_si128(v, lane2), 2),
+                                                         _mm_srli_si128(_mm_and_si128(v, lane3), 3)));
+
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(p), packed);
+        const int32_t tail = _mm_cvtsi128_si32(_mm_srli_si128(packed, 8));
+        std::memcpy(p + 8, &tail, sizeof(tail));
+    }
+
+    PCM_KERNELS_SSE2 int deinterleaveSSE2(const uint8_t* src, SampleFormat format, int numChannels,
+                                          float* const* dest, int numFrames)
+    {
+        float* left = dest[0];
+        float* right = numChannels == 2 ? dest[1] : nullptr;
+        int i = 0;
+
+        if (format == SampleFormat::int16LE)
+        {
+            const __m128 scale = _mm_set1_ps(int16Scale);
+            if (numChannels == 1)
+            {
+                for (; i + 8 <= numFrames; i += 8)
+                {
+                    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 2));
+                    const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+                    const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+                    _mm_storeu_ps(left + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+                    _mm_storeu_ps(left + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+                }
+            }
+            else
+            {
+                for (; i + 4 <= numFrames; i += 4)
+                {
+                    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4));
+                    const __m128i l = _mm_srai_epi32(_mm_slli_epi32(v, 16), 16);
+                    const __m128i r = _mm_srai_epi32(v, 16);
+                    _mm_storeu_ps(left + i, _mm_mul_ps(_mm_cvtepi32_ps(l), scale));
+                    _mm_storeu_ps(right + i, _mm_mul_ps(_mm_cvtepi32_ps(r), scale));
+                }
+            }
+        }
+        else if (format == SampleFormat::int24LE)
+        {
+            const __m128 scale = _mm_set1_ps(int24Scale);
+            auto convert = [&](const uint8_t* p) { return _mm_mul_ps(_mm_cvtepi32_ps(load24(p)), scale); };
+
+            if (numChannels == 1)
+            {
+                for (; i + 4 <= numFrames; i += 4)
+                    _mm_storeu_ps(left + i, convert(src + i * 3));
+            }
+            else
+            {
+                for (; i + 4 <= numFrames; i += 4)
+                {
+                    const __m128 a = convert(src + i * 6);
+                    const __m128 b = convert(src + i * 6 + 12);
+                    _mm_storeu_ps(left + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+                    _mm_storeu_ps(right + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+                }
+            }
+        }
+        else
+        {
+            // 32 bit int and float share the shuffles, ints are converted afterwards
+            const bool isInt = format == SampleFormat::int32LE;
+            const __m128 scale = _mm_set1_ps(int32Scale);
+            auto convert = [&](__m128 v) { return isInt ? _mm_mul_ps(_mm_cvtepi32_ps(_mm_castps_si128(v)), scale) : v; };
+            const float* s = reinterpret_cast<const float*>(src);
+
+            if (numChannels == 1)
+            {
+                for (; i + 4 <= numFrames; i += 4)
+                    _mm_storeu_ps(left + i, convert(_mm_loadu_ps(s + i)));
+            }
+            else
+            {
+                for (; i + 4 <= numFrames; i += 4)
+                {
+                    const __m128 a = _mm_loadu_ps(s + i * 2);
+                    const __m128 b = _mm_loadu_ps(s + i * 2 + 4);
+                    _mm_storeu_ps(left + i, convert(_mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0))));
+                    _mm_storeu_ps(right + i, convert(_mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1))));
+                }
+            }
+        }
+
+        return i;
+    }
+
+    PCM_KERNELS_SSE2 int interleaveSSE2(const float* const* source, int numChannels, uint8_t* dst,
+                                        SampleFormat format, int numFrames)
+    {
+        const float* left = source[0];
+        const float* right = numChannels == 2 ? source[1] : nullptr;
+        int i = 0;
+
+        if (format == SampleFormat::float32LE)
+        {
+            float* d = reinterpret_cast<float*>(dst);
+            if (numChannels == 1)
+            {
+                std::memcpy(d, left, sizeof(float) * static_cast<size_t>(numFrames));
+                return numFrames;
+            }
+
+            for (; i + 4 <= numFrames; i += 4)
+            {
+                const __m128 l = _mm_loadu_ps(left + i);
+                const __m128 r = _mm_loadu_ps(right + i);
+                _mm_storeu_ps(d + i * 2, _mm_unpacklo_ps(l, r));
+                _mm_storeu_ps(d + i * 2 + 4, _mm_unpackhi_ps(l, r));
+            }
+            return i;
+        }
+
+        // cvtps rounds to nearest even like the scalar path, clip first so no lane overflows
+        const bool is16 = format == SampleFormat::int16LE;
+        const bool is24 = format == SampleFormat::int24LE;
+        const float fullScale = is16 ? 32768.0f : (is24 ? 8388608.0f : 2147483648.0f);
+        const __m128 scale = _mm_set1_ps(fullScale);
+        const __m128 lower = _mm_set1_ps(-fullScale);
+        const __m128 upper = _mm_set1_ps(is16 ? int16Max : (is24 ? int24Max : int32Max));
+        auto quantise = [&](const float* p) {
+            return _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(p), scale), lower), upper));
+        };
+
+        if (is24)
+        {
+            if (numChannels == 1)
+            {
+                for (; i + 4 <= numFrames; i += 4)
+                    store24(dst + i * 3, quantise(left + i));
+            }
+            else
+            {
+                for (; i + 4 <= numFrames; i += 4)
+                {
+                    const __m128i l = quantise(left + i);
+                    const __m128i r = quantise(right + i);
+                    store24(dst + i * 6, _mm_unpacklo_epi32(l, r));
+                    store24(dst + i * 6 + 12, _mm_unpackhi_epi32(l, r));
+                }
+            }
+        }
+        else if (is16)
+        {
+            if (numChannels == 1)
+            {
+                for (; i + 8 <= numFrames; i += 8)
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 2),
+                                     _mm_packs_epi32(quantise(left + i), quantise(left + i + 4)));
+            }
+            else
+            {
+                for (; i + 4 <= numFrames; i += 4)
+                {
+                    const __m128i l = quantise(left + i);
+                    const __m128i r = quantise(right + i);
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4),
+                                     _mm_packs_epi32(_mm_unpacklo_epi32(l, r), _mm_unpackhi_epi32(l, r)));
+                }
+            }
+        }
+        else
+        {
+            if (numChannels == 1)
+            {
+                for (; i + 4 <= numFrames; i += 4)
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), quantise(left + i));
+            }
+            else
+            {
+                for (; i + 4 <= numFrames; i += 4)
+                {
+                    const __m128i l = quantise(left + i);
+                    const __m128i r = quantise(right + i);
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 8), _mm_unpacklo_epi32(l, r));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 8 + 16), _mm_unpackhi_epi32(l, r));
+                }
+            }
+        }
+
+        return i;
+    }
+#endif
+
+    //==============================================================================
+#if PCM_KERNELS_NEON
+    // 16 packed 24 bit samples to sign-extended int32 in order. vld3 splits the bytes into three planes,
+    // the low two zip into 16 bit halves, the sign-extended top byte forms the upper half
+    inline void load24(const uint8_t* p, int32x4_t (&samples)[4])
+    {
+        const uint8x16x3_t bytes = vld3q_u8(p);
+        const uint8x16x2_t low = vzipq_u8(bytes.val[0], bytes.val[1]);
+        const int8x16_t top = vreinterpretq_s8_u8(bytes.val[2]);
+        const uint16x8x2_t first = vzipq_u16(vreinterpretq_u16_u8(low.val[0]),
+                                             vreinterpretq_u16_s16(vmovl_s8(vget_low_s8(top))));
+        const uint16x8x2_t second = vzipq_u16(vreinterpretq_u16_u8(low.val[1]),
+                                              vreinterpretq_u16_s16(vmovl_s8(vget_high_s8(top))));
+
+        samples[0] = vreinterpretq_s32_u16(first.val[0]);
+        samples[1] = vreinterpretq_s32_u16(first.val[1]);
+        samples[2] = vreinterpretq_s32_u16(second.val[0]);
+        samples[3] = vreinterpretq_s32_u16(second.val[1]);
+    }
+
+    // The low 24 bits of 16 int32 samples as packed bytes, narrowed into three planes for vst3
+    inline void store24(uint8_t* p, const int32x4_t (&samples)[4])
+    {
+        uint16x8_t low[2], high[2];
+        for (int k = 0; k < 2; ++k)
+        {
+            const uint32x4_t a = vreinterpretq_u32_s32(samples[2 * k]);
+            const uint32x4_t b = vreinterpretq_u32_s32(samples[2 * k + 1]);
+            low[k] = vcombine_u16(vmovn_u32(a), vmovn_u32(b));
+            high[k] = vcombine_u16(vshrn_n_u32(a, 16), vshrn_n_u32(b, 16));
+        }
+
+        uint8x16x3_t bytes;
+        bytes.val[0] = vcombine_u8(vmovn_u16(low[0]), vmovn_u16(low[1]));
+        bytes.val[1] = vcombine_u8(vshrn_n_u16(low[0], 8), vshrn_n_u16(low[1], 8));
+        bytes.val[2] = vcombine_u8(vmovn_u16(high[0]), vmovn_u16(high[1]));
+        vst3q_u8(p, bytes);
+    }
+
+    int deinterleaveNEON(const uint8_t* src, SampleFormat format, int numChannels, float* const* dest, int numFrames)
+    {
+        float* left = dest[0];
+        float* right = numChannels == 2 ? dest[1] : nullptr;
+        int i = 0;
+
+        if (format == SampleFormat::int16LE)
+        {
+            const int16_t* s = reinterpret_cast<const int16_t*>(src);
+            auto store = [](float* d, int16x8_t v) {
+                vst1q_f32(d, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v))), int16Scale));
+                vst1q_f32(d + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v))), int16Scale));
+            };
+
+            for (; i + 8 <= numFrames; i += 8)
+            {
+                if (numChannels == 1)
+                    store(left + i, vld1q_s16(s + i));
+                else
+                {
+                    const int16x8x2_t v = vld2q_s16(s + i * 2);
+                    store(left + i, v.val[0]);
+                    store(right + i, v.val[1]);
+                }
+            }
+        }
+        else if (format == SampleFormat::int24LE)
+        {
+            // 16 samples per step: 16 mono frames or 8 stereo frames
+            const int step = numChannels == 1 ? 16 : 8;
+            for (; i + step <= numFrames; i += step)
+            {
+                int32x4_t v[4];
+                load24(src + i * 3 * numChannels, v);
+
+                for (int k = 0; k < 4; k += numChannels)
+                {
+                    if (numChannels == 1)
+                        vst1q_f32(left + i + 4 * k, vmulq_n_f32(vcvtq_f32_s32(v[k]), int24Scale));
+                    else
+                    {
+                        const float32x4_t l = vcvtq_f32_s32(vuzp1q_s32(v[k], v[k + 1]));
+                        const float32x4_t r = vcvtq_f32_s32(vuzp2q_s32(v[k], v[k + 1]));
+                        vst1q_f32(left + i + 2 * k, vmulq_n_f32(l, int24Scale));
+                        vst1q_f32(right + i + 2 * k, vmulq_n_f32(r, int24Scale));
+                    }
+                }
+            }
+        }
+        else if (format == SampleFormat::int32LE)
+        {
+            const int32_t* s = reinterpret_cast<const int32_t*>(src);
+            for (; i + 4 <= numFrames; i += 4)
+            {
+                if (numChannels == 1)
+                    vst1q_f32(left + i, vmulq_n_f32(vcvtq_f32_s32(vld1q_s32(s + i)), int32Scale));
+                else
+                {
+                    const int32x4x2_t v = vld2q_s32(s + i * 2);
+                    vst1q_f32(left + i, vmulq_n_f32(vcvtq_f32_s32(v.val[0]), int32Scale));
+                    vst1q_f32(right + i, vmulq_n_f32(vcvtq_f32_s32(v.val[1]), int32Scale));
+                }
+            }
+        }
+        else
+        {
+            const float* s = reinterpret_cast<const float*>(src);
+            if (numChannels == 1)
+            {
+                std::memcpy(left, s, sizeof(float) * static_cast<size_t>(numFrames));
+                return numFrames;
+            }
+
+            for (; i + 4 <= numFrames; i += 4)
+            {
+                const float32x4x2_t v = vld2q_f32(s + i * 2);
+                vst1q_f32(left + i, v.val[0]);
+                vst1q_f32(right + i, v.val[1]);
+            }
+        }
+
+        return i;
+    }
+
+    int interleaveNEON(const float* const* source, int numChannels, uint8_t* dst, SampleFormat format, int numFrames)
+    {
+        const float* left = source[0];
+        const float* right = numChannels == 2 ? source[1] : nullptr;
+        int i = 0;
+
+        if (format == SampleFormat::float32LE)
+        {
+            float* d = reinterpret_cast<float*>(dst);
+            if (numChannels == 1)
+            {
+                std::memcpy(d, left, sizeof(float) * static_cast<size_t>(numFrames));
+                return numFrames;
+            }
+
+            for (; i + 4 <= numFrames; i += 4)
+                vst2q_f32(d + i * 2, {{vld1q_f32(left + i), vld1q_f32(right + i)}});
+            return i;
+        }
+
+        const bool is16 = format == SampleFormat::int16LE;
+        const bool is24 = format == SampleFormat::int24LE;
+        const float scale = is16 ? 32768.0f : (is24 ? 8388608.0f : 2147483648.0f);
+        const float32x4_t lower = vdupq_n_f32(-scale);
+        const float32x4_t upper = vdupq_n_f32(is16 ? int16Max : (is24 ? int24Max : int32Max));
+        auto quantise = [&](const float* p) {
+            return vcvtnq_s32_f32(vminq_f32(vmaxq_f32(vmulq_n_f32(vld1q_f32(p), scale), lower), upper));
+        };
+
+        if (is24)
+        {
+            const int step = numChannels == 1 ? 16 : 8;
+            for (; i + step <= numFrames; i += step)
+            {
+                int32x4_t v[4];
+                for (int k = 0; k < 4; k += numChannels)
+                {
+                    if (numChannels == 1)
+                        v[k] = quantise(left + i + 4 * k);
+                    else
+                    {
+                        const int32x4_t l = quantise(left + i + 2 * k);
+                        const int32x4_t r = quantise(right + i + 2 * k);
+                        v[k] = vzip1q_s32(l, r);
+                        v[k + 1] = vzip2q_s32(l, r);
+                    }
+                }
+                store24(dst + i * 3 * numChannels, v);
+            }
+        }
+        else if (is16)
+        {
+            int16_t* d = reinterpret_cast<int16_t*>(dst);
+            for (; i + 8 <= numFrames; i += 8)
+            {
+                const int16x8_t l = vcombine_s16(vqmovn_s32(quantise(left + i)), vqmovn_s32(quantise(left + i + 4)));
+                if (numChannels == 1)
+                    vst1q_s16(d + i, l);
+                else
+                {
+                    const int16x8_t r = vcombine_s16(vqmovn_s32(quantise(right + i)),
+                                                     vqmovn_s32(quantise(right + i + 4)));
+                    vst2q_s16(d + i * 2, {{l, r}});
+                }
+            }
+        }
+        else
+        {
+            int32_t* d = reinterpret_cast<int32_t*>(dst);
+            for (; i + 4 <= numFrames; i += 4)
+            {
+                if (numChannels == 1)
+                    vst1q_s32(d + i, quantise(left + i));
+                else
+                    vst2q_s32(d + i * 2, {{quantise(left + i), quantise(right + i)}});
+            }
+        }
+
+        return i;
+    }
+#endif
+
+    //==============================================================================
+    struct Dispatch
+    {
+        int (*deinterleave)(const uint8_t*, SampleFormat, int, float* const*, int);
+        int (*interleave)(const float* const*, int, uint8_t*, SampleFormat, int);
+        const char* name;
+    };
+
+    int deinterleaveNone(const uint8_t*, SampleFormat, int, float* const*, int) { return 0; }
+    int interleaveNone(const float* const*, int, uint8_t*, SampleFormat, int) { return 0; }
+
+    Dispatch selectDispatch()
+    {
+#if JUCE_INTEL
+        if (SystemStats::hasSSE2())
+            return {deinterleaveSSE2, interleaveSSE2, "SSE2"};
+#elif PCM_KERNELS_NEON
+        return {deinterleaveNEON, interleaveNEON, "NEON"};
+#endif
+        return {deinterleaveNone, interleaveNone, "Scalar"};
+    }
+
+    const Dispatch& getDispatch()
+    {
+        static const Dispatch dispatch = selectDispatch();
+        return dispatch;
+    }
+}
+
+int getBytesPerSample(SampleFormat format)
+{
+    switch (format)
+    {
+    case SampleFormat::int16LE:
+    case SampleFormat::int16BE: return 2;
+    case SampleFormat::int24LE:
+    case SampleFormat::int24BE: return 3;
+    default: return 4;
+    }
+}
+
+void deinterleave(const void* source, SampleFormat format, int numChannels, float* const* dest, int numFrames)
+{
+    const auto* src = static_cast<const uint8_t*>(source);
+    const int done = hasVectorPath(format, numChannels, dest)
+                         ? getDispatch().deinterleave(src, format, numChannels, dest, numFrames) : 0;
+    deinterleaveScalar(src, format, numChannels, dest, done, numFrames);
+}
+
+void interleave(const float* const* source, int numChannels, void* dest, SampleFormat format, int numFrames)
+{
+    auto* dst = static_cast<uint8_t*>(dest);
+    const int done = hasVectorPath(format, numChannels, source)
+                         ? getDispatch().interleave(source, numChannels, dst, format, numFrames) : 0;
+    interleaveScalar(source, numChannels, dst, format, done, numFrames);
+}
+
+const char* getInstructionSetName()
+{
+    return getDispatch().name;
+}
+}
@@ -0,0 +1,157 @@
+/*
+  ==============================================================================
+    File:           RenderJobPool.cpp
+    Developers:     D. Robert Hoover and Kris Keillor
+    Repository URL: https://github.com/Top-Notch-DSP/GlobeLoveler
+    Date:           2024 Feb 1
+    License:        GNU General Public License, version 3.0 (GPL-3.0)
+  ==============================================================================
+*/
+
+#include "include/RenderJobPool.h"
+#include <iomanip>
+#include <thread>
+
+RenderJobPool::RenderJobPool(const OfflineRenderer& offlineRenderer, int threads)
+    : renderer(offlineRenderer),
+      numThreads(threads > 0 ? threads : jmax(1, SystemStats::getNumCpus()))
+{
+}
+
+std::vector<RenderJobPool::JobResult> RenderJobPool::render(const Array<File>& inputFiles)
+{
+    results.assign(static_cast<size_t>(inputFiles.size()), {});
+
+    // Longest first, read from the file headers only
+    AudioFormatManager formatManager;
+    formatManager.registerBasicFormats();
+
+    std::vector<std::pair<int64, int>> order;
+    for (int i = 0; i < inputFiles.size(); ++i)
+    {
+        results[i].inputFile = inputFiles[i];
+        results[i].outputFile = renderer.getOutputFileFor(inputFiles[i]);
+
+        std::unique_ptr<AudioFormatReader> reader(formatManager.createReaderFor(inputFiles[i]));
+        order.emplace_back(reader != nullptr ? reader->lengthInSamples : 0, i);
+    }
+    std::stable_sort(order.begin(), order.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+
+    queues.clear();
+    for (int worker = 0; worker < numThreads; ++worker)
+        queues.push_back(std::make_unique<WorkerQueue>());
+
+    for (size_t i = 0; i < order.size(); ++i)
+        queues[i % static_cast<size_t>(numThreads)]->jobs.push_back(order[i].second);
+
+    std::vector<std::thread> workers;
+    for (int worker = 1; worker < numThreads; ++worker)
+        workers.emplace_back([this, worker] { runWorker(worker); });
+
+    // The calling thread is worker 0
+    runWorker(0);
+
+    for (auto& thread : workers)
+        thread.join();
+
+    return std::move(results);
+}
+
+void RenderJobPool::runWorker(int worker)
+{
+    int job = 0;
+    while (popOwn(worker, job) || steal(worker, job))
+    {
+        auto& jobResult = results[static_cast<size_t>(job)];
+        jobResult.worker = worker;
+        jobResult.result = renderer.renderFile(jobResult.inputFile, jobResult.outputFile, &jobResult.stats);
+    }
+}
+
+bool RenderJobPool::popOwn(int worker, int& job)
+{
+    auto& queue = *queues[static_cast<size_t>(worker)];
+    const SpinLock::ScopedLockType lock(queue.lock);
+
+    if (queue.jobs.empty())
+        return false;
+
+    job = queue.jobs.front();
+    queue.jobs.pop_front();
+    return true;
+}
+
+bool RenderJobPool::steal(int worker, int& job)
+{
+    // Jobs are never added once the workers run, so an empty sweep means all work is taken
+    while (true)
+    {
+        int victim = -1;
+        size_t victimSize = 0;
+
+        for (int other = 0; other < numThreads; ++other)
+        {
+            if (other == worker)
+                continue;
+
+            auto& queue = *queues[static_cast<size_t>(other)];
+            const SpinLock::ScopedLockType lock(queue.lock);
+            if (queue.jobs.size() > victimSize)
+            {
+                victim = other;
+                victimSize = queue.jobs.size();
+            }
+        }
+
+        if (victim < 0)
+            return false;
+
+        // The victim may have drained in the meantime, look again if so
+        auto& queue = *queues[static_cast<size_t>(victim)];
+        const SpinLock::ScopedLockType lock(queue.lock);
+        if (!queue.jobs.empty())
+        {
+            job = queue.jobs.back();
+            queue.jobs.pop_back();
+            return true;
+        }
+    }
+}
+
+void RenderJobPool::printReport(const std::vector<JobResult>& results, double wallSeconds, int numThreads,
+                                std::ostream& stream)
+{
+    double totalAudioSeconds = 0.0;
+    double totalRenderSeconds = 0.0;
+    int numFailed = 0;
+
+    stream << std::fixed << std::setprecision(2);
+
+    for (const auto& jobResult : results)
+    {
+        if (jobResult.result.failed())
+        {
+            stream << "FAILED  " << jobResult.inputFile.getFullPathName() << ": "
+                   << jobResult.result.getErrorMessage() << "\n";
+            ++numFailed;
+            continue;
+        }
+
+        const auto audioSeconds = jobResult.stats.getAudioSeconds();
+        totalAudioSeconds += audioSeconds;
+        totalRenderSeconds += jobResult.stats.wallSeconds;
+
+        stream << std::setw(9) << jobResult.stats.wallSeconds << " s  "
+               << std::setw(9) << audioSeconds / jmax(jobResult.stats.wallSeconds, 1.0e-9) << " x  "
+               << "[" << jobResult.worker << "]  " << jobResult.outputFile.getFullPathName() << "\n";
+    }
+
+    const auto realtimeMultiple = totalAudioSeconds / jmax(wallSeconds, 1.0e-9);
+
+    stream << "\n" << results.size() - static_cast<size_t>(numFailed) << " file(s) rendered, " << numFailed << " failed\n"
+           << "Audio:       " << totalAudioSeconds << " s\n"
+           << "Wall time:   " << wallSeconds << " s on " << numThreads << " thread(s)\n"
+           << "Busy time:   " << totalRenderSeconds << " s (" << 100.0 * totalRenderSeconds / jmax(wallSeconds * numThreads, 1.0e-9)
+           << " % utilisation)\n"
+           << "Throughput:  " << realtimeMultiple << " x realtime, " << realtimeMultiple / numThreads << " x realtime per core\n";
+}
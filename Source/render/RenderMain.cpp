@@ -0,0 +1,114 @@
+/*
+  ==============================================================================
+    File:           RenderMain.cpp
+    Developers:     D. Robert Hoover and Kris Keillor
+    Repository URL: https://github.com/Top-Notch-DSP/GlobeLoveler
+    Date:           2024 Feb 1
+    License:        GNU General Public License, version 3.0 (GPL-3.0)
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include <iostream>
+#include "include/OfflineRenderer.h"
+#include "include/RenderJobPool.h"
+
+namespace
+{
+    const char* const usage =
+        "GlobeLovelerRender [--preset <file.xml>] [--block-size <samples>] [--output-dir <dir>] [--suffix <text>] [--threads <n>] [--mmap]\n"
+        "                   [--segment-threads <n>] [--segment-seconds <s>] [--max-error-db <dB>] [--parallel-bands]\n"
+        "                   <files...>\n"
+        "  --threads          files rendered at once, defaults to one per core\n"
+        "  --segment-threads  splits every file into segments rendered in parallel, for few long files\n"
+        "  --max-error-db     largest gain deviation of a segmented render from a serial one, default 0.0001\n"
+        "  --parallel-bands   splits the multiband crossovers across one thread per band, use with --block-size 4096 or more\n"
+        "  --mmap             memory-mapped WAV/AIFF input and WAV output, constant memory for huge files";
+
+    void renderFiles(const ArgumentList& arguments)
+    {
+        auto args = arguments;
+        OfflineRenderer::Settings settings;
+
+        if (args.containsOption("--block-size"))
+            settings.blockSize = args.removeValueForOption("--block-size").getIntValue();
+        if (settings.blockSize <= 0)
+            ConsoleApplication::fail("--block-size must be a positive number of samples");
+
+        if (args.containsOption("--output-dir"))
+        {
+            settings.outputDirectory = File::getCurrentWorkingDirectory()
+                                           .getChildFile(args.removeValueForOption("--output-dir"));
+            if (!settings.outputDirectory.createDirectory())
+                ConsoleApplication::fail("Could not create " + settings.outputDirectory.getFullPathName());
+        }
+
+        if (args.containsOption("--suffix"))
+            settings.outputSuffix = args.removeValueForOption("--suffix");
+
+        if (args.containsOption("--segment-threads"))
+            settings.segmentThreads = jmax(1, args.removeValueForOption("--segment-threads").getIntValue());
+        if (args.containsOption("--segment-seconds"))
+            settings.segmentSeconds = args.removeValueForOption("--segment-seconds").getDoubleValue();
+        if (args.containsOption("--max-error-db"))
+            settings.maxSegmentErrorInDecibels = args.removeValueForOption("--max-error-db").getFloatValue();
+        if (settings.segmentSeconds <= 0.0 || settings.maxSegmentErrorInDecibels <= 0.0f)
+            ConsoleApplication::fail("--segment-seconds and --max-error-db must be positive");
+
+        settings.memoryMapped = args.removeOptionIfFound("--mmap");
+        settings.parallelBands = args.removeOptionIfFound("--parallel-bands");
+
+        int numThreads = 0;
+        if (args.containsOption("--threads"))
+            numThreads = args.removeValueForOption("--threads").getIntValue();
+
+        OfflineRenderer renderer(settings);
+
+        if (args.containsOption("--preset"))
+        {
+            const auto presetFile = File::getCurrentWorkingDirectory()
+                                        .getChildFile(args.removeValueForOption("--preset"));
+            const auto result = renderer.loadPreset(presetFile);
+            if (result.failed())
+                ConsoleApplication::fail(result.getErrorMessage());
+        }
+
+        Array<File> inputFiles;
+        for (const auto& argument : args.arguments)
+        {
+            if (argument.isOption())
+                ConsoleApplication::fail("Unknown option " + argument.text);
+            inputFiles.add(argument.resolveAsExistingFile());
+        }
+
+        if (inputFiles.isEmpty())
+            ConsoleApplication::fail(String("No input files\n") + usage);
+
+        RenderJobPool pool(renderer, jmin(numThreads > 0 ? numThreads : SystemStats::getNumCpus(), inputFiles.size()));
+
+        const auto startTicks = Time::getHighResolutionTicks();
+        const auto results = pool.render(inputFiles);
+        const auto wallSeconds = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - startTicks);
+
+        RenderJobPool::printReport(results, wallSeconds, pool.getNumThreads(), std::cout);
+
+        const auto numFailed = std::count_if(results.begin(), results.end(),
+                                             [](const auto& jobResult) { return jobResult.result.failed(); });
+        if (numFailed > 0)
+            ConsoleApplication::fail(String(static_cast<int>(numFailed)) + " of " + String(inputFiles.size()) + " file(s) failed", 2);
+    }
+}
+
+//==============================================================================
+int main(int argc, char* argv[])
+{
+    // The parameter tree expects a MessageManager to exist, nothing is ever dispatched on it
+    ScopedJuceInitialiser_GUI juceInitialiser;
+
+    ConsoleApplication app;
+    app.addHelpCommand("--help|-h", usage, false);
+    app.addDefaultCommand({"", usage, "Renders every input file through GlobeLoveler", {},
+                           [](const ArgumentList& args) { renderFiles(args); }});
+
+    return app.findAndRunCommand(argc, argv);
+}
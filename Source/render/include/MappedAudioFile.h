@@ -0,0 +1,107 @@
+/*
+  ==============================================================================
+    File:           MappedAudioFile.h
+    Developers:     D. Robert Hoover and Kris Keillor
+    Repository URL: https://github.com/Top-Notch-DSP/GlobeLoveler
+    Date:           2024 Feb 1
+    License:        GNU General Public License, version 3.0 (GPL-3.0)
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PcmKernels.h"
+
+/* MappedWindow:
+ * Maps a sliding window of a file instead of the whole file, so resident memory stays at
+ * about one window no matter how large the file is. Pages of the previous window are released
+ * (and written back in read-write mode) when the window moves.
+ */
+class MappedWindow
+{
+public:
+    static constexpr int64 defaultWindowSize = 16 * 1024 * 1024;
+
+    MappedWindow(const File& file, MemoryMappedFile::AccessMode mode, int64 windowSize = defaultWindowSize);
+
+    // Returns the address of the byte at position with at least numBytes mapped behind it, nullptr on failure.
+    // Stays valid until the next call
+    uint8* map(int64 position, int64 numBytes);
+
+    // Unmaps the current window
+    void release();
+
+    int64 getWindowSize() const { return windowSize; }
+
+private:
+    File file;
+    MemoryMappedFile::AccessMode mode;
+    int64 windowSize;
+    int64 fileSize;
+    std::unique_ptr<MemoryMappedFile> mapping;
+};
+
+//==============================================================================
+/* MappedAudioFormatReader:
+ * Reads uncompressed 16/24/32 bit integer and 32 bit float WAV and AIFF/AIFC files through a
+ * MappedWindow. Samples are converted by PcmKernels straight into the caller's float buffers,
+ * with no buffering in between.
+ */
+class MappedAudioFormatReader : public AudioFormatReader
+{
+public:
+    // Returns nullptr for anything it can't map, e.g. compressed, 8 bit or RF64 files
+    static std::unique_ptr<MappedAudioFormatReader> create(const File& file);
+
+    bool readSamples(int* const* destChannels, int numDestChannels, int startOffsetInDestBuffer,
+                     int64 startSampleInFile, int numSamples) override;
+
+private:
+    MappedAudioFormatReader(const File& file, const String& formatName);
+
+    bool parseWav(FileInputStream&);
+    bool parseAiff(FileInputStream&);
+
+    MappedWindow window;
+    PcmKernels::SampleFormat sampleFormat{PcmKernels::SampleFormat::int16LE};
+    int64 dataOffset{0};
+    int frameBytes{0};
+    std::vector<float*> channelPointers;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MappedAudioFormatReader)
+};
+
+//==============================================================================
+/* MappedWavWriter:
+ * Writes a WAV file of known length into a preallocated file through a MappedWindow.
+ * Takes float data (usesFloatingPointData) and converts it with PcmKernels.
+ * If fewer frames than announced are written, the header and file are trimmed on destruction.
+ */
+class MappedWavWriter : public AudioFormatWriter
+{
+public:
+    // bitsPerSample 16 or 24 writes integer PCM, 32 writes float.
+    // Returns nullptr if the file can't be created or the data would not fit a plain RIFF file
+    static std::unique_ptr<MappedWavWriter> create(const File& file, double sampleRate, int numChannels,
+                                                   int bitsPerSample, int64 numFrames);
+
+    ~MappedWavWriter() override;
+
+    bool write(const int** samplesToWrite, int numSamples) override;
+
+private:
+    MappedWavWriter(const File& file, double sampleRate, int numChannels, int bitsPerSample, int64 numFrames);
+
+    static MemoryBlock createHeader(int numChannels, double sampleRate, int bitsPerSample, int64 dataBytes);
+
+    File file;
+    MappedWindow window;
+    PcmKernels::SampleFormat sampleFormat;
+    int frameBytes;
+    int64 dataOffset{0};
+    int64 numFrames;
+    int64 framesWritten{0};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MappedWavWriter)
+};
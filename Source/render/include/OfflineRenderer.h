@@ -0,0 +1,89 @@
+/*
+  ==============================================================================
+    File:           OfflineRenderer.h
+    Developers:     D. Robert Hoover and Kris Keillor
+    Repository URL: https://github.com/Top-Notch-DSP/GlobeLoveler
+    Date:           2024 Feb 1
+    License:        GNU General Public License, version 3.0 (GPL-3.0)
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+class GlobeLoveler;
+
+/* OfflineRenderer:
+ * Streams audio files through a GlobeLoveler processor without audio device or editor.
+ * Every render creates its own processor from the stored preset, so separate
+ * renders share no state and may run on any thread.
+ */
+class OfflineRenderer
+{
+public:
+    struct Settings
+    {
+        int blockSize{512};                 // Samples per processBlock call
+        File outputDirectory;               // Next to the input file when empty
+        String outputSuffix{"_globeloveler"};
+
+        // Reads WAV/AIFF and writes WAV through sliding memory-mapped windows with SIMD PCM conversion,
+        // files the mapped reader can't handle fall back to AudioFormatManager
+        bool memoryMapped{false};
+
+        // Splits each file into segments rendered on this many threads, 1 renders serially.
+        // Every segment pre-rolls until the ballistics are within maxSegmentErrorInDecibels of a serial render
+        int segmentThreads{1};
+        double segmentSeconds{30.0};        // Raised to four pre-rolls when the release is long
+        float maxSegmentErrorInDecibels{1.0e-4f};
+
+        // Splits the multiband crossovers of every block across one thread per band,
+        // pays off with blocks of MultibandCompressor::minParallelBlockSize samples and more
+        bool parallelBands{false};
+    };
+
+    // Filled by renderFile for the throughput report
+    struct Stats
+    {
+        int64 numSamples{0};
+        double sampleRate{0.0};
+        double wallSeconds{0.0};
+
+        double getAudioSeconds() const { return sampleRate > 0.0 ? static_cast<double>(numSamples) / sampleRate : 0.0; }
+    };
+
+    OfflineRenderer() = default;
+    explicit OfflineRenderer(const Settings&);
+
+    // Loads a preset as written by GlobeLoveler::getStateInformation, either the full
+    // <GlobeLovelerState> XML or only its <PARAMETERS> element
+    Result loadPreset(const File& presetFile);
+
+    // Returns where renderFile writes the result for the given input, always a WAV file
+    File getOutputFileFor(const File& inputFile) const;
+
+    // Renders one file in blocks of Settings::blockSize, keeps sample rate, channel count and bit depth
+    Result renderFile(const File& inputFile, const File& outputFile, Stats* stats = nullptr) const;
+
+    const Settings& getSettings() const { return settings; }
+
+private:
+    std::unique_ptr<AudioFormatReader> createReader(const File& inputFile) const;
+    std::unique_ptr<AudioFormatWriter> createWriter(const File& outputFile, const AudioFormatReader&) const;
+    // Returns nullptr when the processor doesn't support the channel count
+    std::unique_ptr<GlobeLoveler> createProcessor(int numChannels, double sampleRate) const;
+    // Fills buffer from reader, starting at readerStart, and processes it in place block by block
+    Result process(GlobeLoveler&, AudioFormatReader&, AudioBuffer<float>& buffer, int64 readerStart) const;
+    // Feeds the processor's latency worth of input from readerStart and drops the output,
+    // afterwards output sample n belongs to input sample readerStart + n
+    Result skipLatency(GlobeLoveler&, AudioFormatReader&, int64 readerStart) const;
+
+    Result renderSerial(AudioFormatReader&, AudioFormatWriter&) const;
+    Result renderSegmented(const File& inputFile, AudioFormatReader&, AudioFormatWriter&) const;
+
+    Settings settings;
+    MemoryBlock presetState;    // Binary state for setStateInformation, empty = parameter defaults
+
+    JUCE_LEAK_DETECTOR(OfflineRenderer)
+};
@@ -0,0 +1,43 @@
+/*
+  ==============================================================================
+    File:           PcmKernels.h
+    Developers:     D. Robert Hoover and Kris Keillor
+    Repository URL: https://github.com/Top-Notch-DSP/GlobeLoveler
+    Date:           2024 Feb 1
+    License:        GNU General Public License, version 3.0 (GPL-3.0)
+  ==============================================================================
+*/
+
+#pragma once
+
+/* PcmKernels:
+ * Conversion between interleaved PCM as stored in WAV/AIFF files and planar float.
+ * Mono and stereo 16, 24 and 32 bit int and float little-endian data use SSE2 or NEON,
+ * everything else (big-endian, more channels) runs the scalar loop.
+ */
+namespace PcmKernels
+{
+    enum class SampleFormat
+    {
+        int16LE,
+        int16BE,
+        int24LE,
+        int24BE,
+        int32LE,
+        int32BE,
+        float32LE,
+        float32BE
+    };
+
+    int getBytesPerSample(SampleFormat);
+
+    // Converts numFrames interleaved frames to float in [-1, 1). Null destinations are skipped
+    void deinterleave(const void* source, SampleFormat, int numChannels, float* const* dest, int numFrames);
+
+    // Converts numFrames planar float frames to interleaved PCM,
+    // integer formats are clipped to full scale and rounded to nearest
+    void interleave(const float* const* source, int numChannels, void* dest, SampleFormat, int numFrames);
+
+    // Returns the name of the instruction set the kernels dispatch to
+    const char* getInstructionSetName();
+}
@@ -0,0 +1,66 @@
+/*
+  ==============================================================================
+    File:           RenderJobPool.h
+    Developers:     D. Robert Hoover and Kris Keillor
+    Repository URL: https://github.com/Top-Notch-DSP/GlobeLoveler
+    Date:           2024 Feb 1
+    License:        GNU General Public License, version 3.0 (GPL-3.0)
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <deque>
+#include <ostream>
+#include "OfflineRenderer.h"
+
+/* RenderJobPool:
+ * Renders a list of files on a fixed set of worker threads. Jobs are sorted longest first
+ * and dealt round-robin into one deque per worker. A worker takes from the front of its own
+ * deque and, once empty, steals from the back of the fullest other deque, so the long files
+ * start early and no core idles while work is left. Every render creates its own processor.
+ */
+class RenderJobPool
+{
+public:
+    struct JobResult
+    {
+        File inputFile;
+        File outputFile;
+        Result result{Result::ok()};
+        OfflineRenderer::Stats stats;
+        int worker{-1};
+    };
+
+    // numThreads <= 0 uses every core
+    RenderJobPool(const OfflineRenderer& renderer, int numThreads);
+
+    // Renders all files and returns one result per input, in input order
+    std::vector<JobResult> render(const Array<File>& inputFiles);
+
+    int getNumThreads() const { return numThreads; }
+
+    // Per-file wall time and realtime factor, followed by totals and realtime multiple per core
+    static void printReport(const std::vector<JobResult>& results, double wallSeconds, int numThreads,
+                            std::ostream& stream);
+
+private:
+    struct WorkerQueue
+    {
+        SpinLock lock;
+        std::deque<int> jobs;
+    };
+
+    void runWorker(int worker);
+    bool popOwn(int worker, int& job);
+    bool steal(int worker, int& job);
+
+    const OfflineRenderer& renderer;
+    const int numThreads;
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+    std::vector<JobResult> results;
+
+    JUCE_DECLARE_NON_COPYABLE(RenderJobPool)
+};
@@ -122,5 +122,36 @@ namespace Constants
         constexpr float mixStart = 0.0f;
         constexpr float mixEnd = 1.0f;
         constexpr float mixInterval = 0.001f;
+
+        // Same limit as Compressor::maxLookaheadInMs
+        constexpr float lookaheadStart = 0.0f;
+        constexpr float lookaheadEnd = 10.0f;
+        constexpr float lookaheadInterval = 0.01f;
+
+        // True-peak limiter
+        constexpr float ceilingStart = -12.0f;
+        constexpr float ceilingEnd = 0.0f;
+        constexpr float ceilingInterval = 0.1f;
+
+        constexpr float limiterReleaseStart = 1.0f;
+        constexpr float limiterReleaseEnd = 1000.0f;
+        constexpr float limiterReleaseInterval = 0.1f;
+
+        // Sidechain filter, a high-pass of 0 Hz is off
+        constexpr float sidechainHighPassStart = 0.0f;
+        constexpr float sidechainHighPassEnd = 500.0f;
+        constexpr float sidechainHighPassInterval = 1.0f;
+        constexpr float sidechainTiltStart = -12.0f;
+        constexpr float sidechainTiltEnd = 12.0f;
+        constexpr float sidechainTiltInterval = 0.1f;
+
+        // Multiband crossovers, the ones between low and high are spaced evenly in log frequency
+        constexpr float crossoverLowStart = 40.0f;
+        constexpr float crossoverLowEnd = 1000.0f;
+        constexpr float crossoverLowDefault = 150.0f;
+        constexpr float crossoverHighStart = 1000.0f;
+        constexpr float crossoverHighEnd = 16000.0f;
+        constexpr float crossoverHighDefault = 5000.0f;
+        constexpr float crossoverInterval = 1.0f;
     }
 }
@@ -0,0 +1,465 @@
+/*
+  ==============================================================================
+    File:           RealtimeSafety.cpp
+    Developers:     D. Robert Hoover and Kris Keillor
+    Repository URL: https://github.com/Top-Notch-DSP/GlobeLoveler
+    Date:           2024 Feb 1
+    License:        GNU General Public License, version 3.0 (GPL-3.0)
+  ==============================================================================
+*/
+
+#include "RealtimeSafety.h"
+
+#if GLOBE_LOVELER_RT_ASSERTIONS
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cerrno>
+#include <cstdlib>
+#include <new>
+
+#if JUCE_LINUX || JUCE_MAC
+    #include <execinfo.h>
+    #include <pthread.h>
+    #define REALTIME_SAFETY_BACKTRACE 1
+#endif
+
+#if JUCE_WINDOWS
+    #include <malloc.h>
+#endif
+
+#if JUCE_LINUX && defined(__GLIBC__)
+    #include <dlfcn.h>
+    #define REALTIME_SAFETY_LIBC_HOOKS 1
+#endif
+
+#if REALTIME_SAFETY_LIBC_HOOKS
+// glibc exports its implementations under internal names, which lets us wrap the public ones
+extern "C"
+{
+    void* __libc_malloc(size_t);
+    void* __libc_calloc(size_t, size_t);
+    void* __libc_realloc(void*, size_t);
+    void* __libc_memalign(size_t, size_t);
+    void* __libc_valloc(size_t);
+    void* __libc_pvalloc(size_t);
+    void __libc_free(void*);
+}
+#endif
+
+// The thread-local flags are read inside malloc, dynamic TLS could allocate on first access
+#if defined(__GNUC__)
+    #define REALTIME_SAFETY_TLS thread_local __attribute__((tls_model("initial-exec")))
+#else
+    #define REALTIME_SAFETY_TLS thread_local
+#endif
+
+namespace RealtimeSafety
+{
+namespace
+{
+    constexpr int maxFrames = 24;
+    constexpr int skippedFrames = 3; // captureFrames(), record() and reportViolation() when not inlined
+    constexpr int maxCallSites = 256;
+
+    // One slot per distinct call site, filled lock-free from the audio thread
+    struct CallSite
+    {
+        std::atomic<uint64_t> key{0};
+        std::atomic<int> count{0};
+        Violation violation{Violation::allocation};
+        void* frames[maxFrames]{};
+        int numFrames{0};
+    };
+
+    CallSite callSites[maxCallSites];
+    std::atomic<int> numViolations{0};
+    std::atomic<int> numDroppedViolations{0};
+
+    REALTIME_SAFETY_TLS int realtimeDepth = 0;
+    REALTIME_SAFETY_TLS bool insideHook = false;
+
+    const char* getName(Violation violation)
+    {
+        return violation == Violation::mutexLock ? "mutex lock" : "heap allocation";
+    }
+
+    int captureFrames(void** frames)
+    {
+#if REALTIME_SAFETY_BACKTRACE
+        return backtrace(frames, maxFrames);
+#else
+        ignoreUnused(frames);
+        return 0;
+#endif
+    }
+
+    void printFrames(void* const* frames, int numFrames)
+    {
+#if REALTIME_SAFETY_BACKTRACE
+        backtrace_symbols_fd(frames, numFrames, 2);
+#else
+        ignoreUnused(frames, numFrames);
+#endif
+    }
+
+    // Identifies a call site by the first few frames above the hook
+    uint64_t hashFrames(void* const* frames, int numFrames)
+    {
+        uint64_t hash = 1469598103934665603ull;
+        for (int i = skippedFrames; i < jmin(numFrames, skippedFrames + 4); ++i)
+            hash = (hash ^ static_cast<uint64_t>(reinterpret_cast<uintptr_t>(frames[i]))) * 1099511628211ull;
+        return hash == 0 ? 1 : hash;
+    }
+
+    void record(Violation violation)
+    {
+        void* frames[maxFrames];
+        const int numFrames = captureFrames(frames);
+        numViolations.fetch_add(1, std::memory_order_relaxed);
+
+#if GLOBE_LOVELER_RT_ASSERTIONS == 2
+        std::fprintf(stderr, "RealtimeSafety: %s on the audio thread\n", getName(violation));
+        printFrames(frames, numFrames);
+        std::abort();
+#else
+        const uint64_t key = hashFrames(frames, numFrames);
+        for (int probe = 0; probe < maxCallSites; ++probe)
+        {
+            auto& site = callSites[(key + static_cast<uint64_t>(probe)) % maxCallSites];
+            uint64_t expected = 0;
+
+            if (site.key.compare_exchange_strong(expected, key))
+            {
+                // First hit of this call site, keep its stack and trap once
+                site.violation = violation;
+                site.numFrames = numFrames;
+                for (int i = 0; i < numFrames; ++i)
+                    site.frames[i] = frames[i];
+                site.count.store(1, std::memory_order_release);
+                jassertfalse; // Real-time violation on the audio thread, see RealtimeSafety::dumpReport()
+                return;
+            }
+
+            if (expected == key)
+            {
+                site.count.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+        }
+
+        numDroppedViolations.fetch_add(1, std::memory_order_relaxed);
+#endif
+    }
+
+#if REALTIME_SAFETY_LIBC_HOOKS
+    using MutexLockFunction = int (*)(pthread_mutex_t*);
+    std::atomic<MutexLockFunction> realMutexLock{nullptr};
+
+    MutexLockFunction getRealMutexLock()
+    {
+        auto function = realMutexLock.load(std::memory_order_acquire);
+        if (function == nullptr)
+        {
+            function = reinterpret_cast<MutexLockFunction>(dlsym(RTLD_NEXT, "pthread_mutex_lock"));
+            realMutexLock.store(function, std::memory_order_release);
+        }
+        return function;
+    }
+#endif
+
+    void* allocate(std::size_t size)
+    {
+#if REALTIME_SAFETY_LIBC_HOOKS
+        return __libc_malloc(size == 0 ? 1 : size);
+#else
+        return std::malloc(size == 0 ? 1 : size);
+#endif
+    }
+
+    void deallocate(void* ptr)
+    {
+#if REALTIME_SAFETY_LIBC_HOOKS
+        __libc_free(ptr);
+#else
+        std::free(ptr);
+#endif
+    }
+
+    void* allocateAligned(std::size_t size, std::size_t alignment)
+    {
+        size = size == 0 ? 1 : size;
+#if REALTIME_SAFETY_LIBC_HOOKS
+        return __libc_memalign(alignment, size);
+#elif JUCE_WINDOWS
+        return _aligned_malloc(size, alignment);
+#else
+        void* ptr = nullptr;
+        return posix_memalign(&ptr, jmax(alignment, sizeof(void*)), size) == 0 ? ptr : nullptr;
+#endif
+    }
+
+    void deallocateAligned(void* ptr)
+    {
+#if JUCE_WINDOWS
+        _aligned_free(ptr);
+#else
+        deallocate(ptr);
+#endif
+    }
+
+    bool isValidAlignment(std::size_t alignment)
+    {
+        return alignment != 0 && (alignment & (alignment - 1)) == 0;
+    }
+
+    // backtrace() loads its unwinder lazily and dlsym() may allocate, do both before any audio runs
+    struct WarmUp
+    {
+        WarmUp()
+        {
+            void* frames[maxFrames];
+            captureFrames(frames);
+#if REALTIME_SAFETY_LIBC_HOOKS
+            getRealMutexLock();
+#endif
+        }
+    };
+
+    WarmUp warmUp;
+}
+
+ScopedRealtimeSection::ScopedRealtimeSection()
+{
+    ++realtimeDepth;
+}
+
+ScopedRealtimeSection::~ScopedRealtimeSection()
+{
+    --realtimeDepth;
+}
+
+bool isInRealtimeSection()
+{
+    return realtimeDepth > 0;
+}
+
+void reportViolation(Violation violation)
+{
+    if (realtimeDepth > 0 && !insideHook)
+    {
+        // Reporting itself may allocate (assertion logging), don't recurse into it
+        insideHook = true;
+        record(violation);
+        insideHook = false;
+    }
+}
+
+int getNumViolations()
+{
+    return numViolations.load();
+}
+
+void dumpReport()
+{
+    std::fprintf(stderr, "RealtimeSafety: %d violation(s) on the audio thread\n", getNumViolations());
+
+    for (auto& site : callSites)
+    {
+        const int count = site.count.load(std::memory_order_acquire);
+        if (count == 0)
+            continue;
+
+        std::fprintf(stderr, "\n%d x %s at:\n", count, getName(site.violation));
+        printFrames(site.frames, site.numFrames);
+    }
+
+    if (const int dropped = numDroppedViolations.load())
+        std::fprintf(stderr, "\n%d violation(s) dropped, call site table full\n", dropped);
+}
+}
+
+//==============================================================================
+// Global replacements, check the calling thread and go straight to the allocator so
+// each allocation is only reported once
+void* operator new(std::size_t size)
+{
+    RealtimeSafety::reportViolation(RealtimeSafety::Violation::allocation);
+    if (void* ptr = RealtimeSafety::allocate(size))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    RealtimeSafety::reportViolation(RealtimeSafety::Violation::allocation);
+    return RealtimeSafety::allocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    return operator new(size, std::nothrow);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    if (ptr != nullptr)
+        RealtimeSafety::reportViolation(RealtimeSafety::Violation::allocation);
+    RealtimeSafety::deallocate(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    operator delete(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    operator delete(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept
+{
+    operator delete(ptr);
+}
+
+// Over-aligned types (alignas beyond the default new alignment) come through these
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    RealtimeSafety::reportViolation(RealtimeSafety::Violation::allocation);
+    if (void* ptr = RealtimeSafety::allocateAligned(size, static_cast<std::size_t>(alignment)))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return operator new(size, alignment);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    RealtimeSafety::reportViolation(RealtimeSafety::Violation::allocation);
+    return RealtimeSafety::allocateAligned(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return operator new(size, alignment, std::nothrow);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept
+{
+    if (ptr != nullptr)
+        RealtimeSafety::reportViolation(RealtimeSafety::Violation::allocation);
+    RealtimeSafety::deallocateAligned(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t alignment) noexcept
+{
+    operator delete(ptr, alignment);
+}
+
+void operator delete(void* ptr, std::size_t, std::align_val_t alignment) noexcept
+{
+    operator delete(ptr, alignment);
+}
+
+void operator delete[](void* ptr, std::size_t, std::align_val_t alignment) noexcept
+{
+    operator delete(ptr, alignment);
+}
+
+void operator delete(void* ptr, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    operator delete(ptr, alignment);
+}
+
+void operator delete[](void* ptr, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    operator delete(ptr, alignment);
+}
+
+//==============================================================================
+#if REALTIME_SAFETY_LIBC_HOOKS
+extern "C"
+{
+    void* malloc(size_t size)
+    {
+        RealtimeSafety::reportViolation(RealtimeSafety::Violation::allocation);
+        return __libc_malloc(size);
+    }
+
+    void* calloc(size_t count, size_t size)
+    {
+        RealtimeSafety::reportViolation(RealtimeSafety::Violation::allocation);
+        return __libc_calloc(count, size);
+    }
+
+    void* realloc(void* ptr, size_t size)
+    {
+        RealtimeSafety::reportViolation(RealtimeSafety::Violation::allocation);
+        return __libc_realloc(ptr, size);
+    }
+
+    void* memalign(size_t alignment, size_t size)
+    {
+        RealtimeSafety::reportViolation(RealtimeSafety::Violation::allocation);
+        return __libc_memalign(alignment, size);
+    }
+
+    void* aligned_alloc(size_t alignment, size_t size)
+    {
+        RealtimeSafety::reportViolation(RealtimeSafety::Violation::allocation);
+        return __libc_memalign(alignment, size);
+    }
+
+    int posix_memalign(void** ptr, size_t alignment, size_t size)
+    {
+        RealtimeSafety::reportViolation(RealtimeSafety::Violation::allocation);
+        if (!RealtimeSafety::isValidAlignment(alignment) || alignment % sizeof(void*) != 0)
+            return EINVAL;
+
+        void* result = __libc_memalign(alignment, size);
+        if (result == nullptr)
+            return ENOMEM;
+
+        *ptr = result;
+        return 0;
+    }
+
+    void* valloc(size_t size)
+    {
+        RealtimeSafety::reportViolation(RealtimeSafety::Violation::allocation);
+        return __libc_valloc(size);
+    }
+
+    void* pvalloc(size_t size)
+    {
+        RealtimeSafety::reportViolation(RealtimeSafety::Violation::allocation);
+        return __libc_pvalloc(size);
+    }
+
+    void free(void* ptr)
+    {
+        if (ptr != nullptr)
+            RealtimeSafety::reportViolation(RealtimeSafety::Violation::allocation);
+        __libc_free(ptr);
+    }
+
+    int pthread_mutex_lock(pthread_mutex_t* mutex)
+    {
+        RealtimeSafety::reportViolation(RealtimeSafety::Violation::mutexLock);
+        return RealtimeSafety::getRealMutexLock()(mutex);
+    }
+}
+#endif
+
+#endif
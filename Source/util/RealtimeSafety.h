@@ -0,0 +1,70 @@
+/*
+  ==============================================================================
+    File:           RealtimeSafety.h
+    Developers:     D. Robert Hoover and Kris Keillor
+    Repository URL: https://github.com/Top-Notch-DSP/GlobeLoveler
+    Date:           2024 Feb 1
+    License:        GNU General Public License, version 3.0 (GPL-3.0)
+  ==============================================================================
+*/
+
+#pragma once
+
+// Real-time safety checks for the audio callbacks, set in the project's preprocessor definitions:
+// 0 = off
+// 1 = record every violation with its stack trace and jassert once per call site
+// 2 = print the stack trace of the first violation and abort
+#ifndef GLOBE_LOVELER_RT_ASSERTIONS
+    #define GLOBE_LOVELER_RT_ASSERTIONS 0
+#endif
+
+namespace RealtimeSafety
+{
+    // What the audio thread was caught doing
+    enum class Violation
+    {
+        allocation,   // operator new/delete (aligned too), malloc/calloc/realloc/free and the aligned allocators
+        mutexLock     // pthread_mutex_lock
+    };
+
+#if GLOBE_LOVELER_RT_ASSERTIONS
+    /* Marks the current thread as real-time for the lifetime of the object.
+     * operator new/delete are checked on every platform. malloc/free, memalign, aligned_alloc, posix_memalign,
+     * valloc/pvalloc and pthread_mutex_lock are hooked on Linux (glibc) when the hooks are linked into
+     * the executable, as for the standalone app.
+     * Only open it around code we own: host and JUCE callback wrappers take locks of their own.
+     */
+    class ScopedRealtimeSection
+    {
+    public:
+        ScopedRealtimeSection();
+        ~ScopedRealtimeSection();
+
+        ScopedRealtimeSection(const ScopedRealtimeSection&) = delete;
+        ScopedRealtimeSection& operator=(const ScopedRealtimeSection&) = delete;
+    };
+
+    // Returns true while the calling thread is inside a ScopedRealtimeSection
+    bool isInRealtimeSection();
+
+    // Records a violation if the calling thread is inside a ScopedRealtimeSection
+    void reportViolation(Violation);
+
+    // Total number of violations recorded so far
+    int getNumViolations();
+
+    // Prints every recorded call site with its counter and stack trace to stderr, call from a non-real-time thread
+    void dumpReport();
+#else
+    class ScopedRealtimeSection
+    {
+    public:
+        ScopedRealtimeSection() {}
+    };
+
+    inline bool isInRealtimeSection() { return false; }
+    inline void reportViolation(Violation) {}
+    inline int getNumViolations() { return 0; }
+    inline void dumpReport() {}
+#endif
+}